@@ -2,4 +2,6 @@
 if not exist build mkdir build
 pushd build
 cl /Zi /nologo ../source/generator.c
+cl /O2 /Zi /nologo ../source/tokenizer_benchmark.c
+cl /O2 /Zi /nologo ../source/site_benchmark.c
 popd
\ No newline at end of file
@@ -1,7 +1,38 @@
+#if defined(__linux__)
+// NOTE(rjf): For copy_file_range.
+#define _GNU_SOURCE
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+// NOTE(rjf): winnt.h has an enumerator called TokenType, which collides with ours.
+#define TokenType TokenType_Win32
+#include <windows.h>
+#include <psapi.h>
+#undef TokenType
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <dirent.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <linux/fs.h>
+#endif
 
 typedef int8_t   i8;
 typedef int16_t  i16;
@@ -19,6 +50,229 @@ typedef uint64_t u64;
 #define QuickSort               qsort
 #define Log(...) { fprintf(stdout, __VA_ARGS__); fprintf(stdout, "\n"); }
 
+//~ NOTE(rjf): Threads
+
+#if defined(_WIN32)
+typedef HANDLE ThreadHandle;
+#define THREAD_PROC(name) DWORD WINAPI name(void *data)
+#else
+typedef pthread_t ThreadHandle;
+#define THREAD_PROC(name) void *name(void *data)
+#endif
+typedef THREAD_PROC(ThreadProc);
+
+#if defined(_WIN32)
+typedef SRWLOCK Mutex;
+#define MUTEX_INITIALIZER SRWLOCK_INIT
+#else
+typedef pthread_mutex_t Mutex;
+#define MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+static ThreadHandle
+ThreadLaunch(ThreadProc *proc, void *data)
+{
+    ThreadHandle thread = {0};
+#if defined(_WIN32)
+    thread = CreateThread(0, 0, proc, data, 0, 0);
+#else
+    pthread_create(&thread, 0, proc, data);
+#endif
+    return thread;
+}
+
+static void
+ThreadJoin(ThreadHandle thread)
+{
+#if defined(_WIN32)
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, 0);
+#endif
+}
+
+static void
+MutexLock(Mutex *mutex)
+{
+#if defined(_WIN32)
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+static void
+MutexUnlock(Mutex *mutex)
+{
+#if defined(_WIN32)
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+static i32
+AtomicIncrementI32(volatile i32 *value)
+{
+#if defined(_WIN32)
+    return InterlockedIncrement((volatile LONG *)value);
+#else
+    return __sync_add_and_fetch(value, 1);
+#endif
+}
+
+static int
+GetProcessorCount(void)
+{
+    int count = 1;
+#if defined(_WIN32)
+    SYSTEM_INFO info = {0};
+    GetSystemInfo(&info);
+    count = (int)info.dwNumberOfProcessors;
+#else
+    count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return count > 0 ? count : 1;
+}
+
+static u64
+GetTimeMicroseconds(void)
+{
+    u64 microseconds = 0;
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    if(!frequency.QuadPart)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    microseconds = (u64)(counter.QuadPart / frequency.QuadPart) * 1000000ull +
+        (u64)(counter.QuadPart % frequency.QuadPart) * 1000000ull / (u64)frequency.QuadPart;
+#else
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    microseconds = (u64)time.tv_sec * 1000000ull + (u64)time.tv_nsec / 1000ull;
+#endif
+    return microseconds;
+}
+
+static u64
+GetPeakMemoryUsage(void)
+{
+    u64 bytes = 0;
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters = {0};
+    if(K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        bytes = counters.PeakWorkingSetSize;
+    }
+#else
+    struct rusage usage = {0};
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#if defined(__APPLE__)
+        bytes = (u64)usage.ru_maxrss;
+#else
+        bytes = (u64)usage.ru_maxrss * 1024;
+#endif
+    }
+#endif
+    return bytes;
+}
+
+//~ NOTE(rjf): Jobs
+//
+// A job is just an index into some caller-owned array. Workers pull indices off of a shared
+// counter until they run out, so a job list is always fully finished when RunJobs returns,
+// which is what we use as the barrier between pipeline phases. Worker 0 always runs on the
+// calling thread, and with a single worker, jobs run serially in index order.
+
+#define JOB_PROC(name) void name(void *user_data, int job_index, int worker_index)
+typedef JOB_PROC(JobProc);
+
+typedef struct JobQueue JobQueue;
+struct JobQueue
+{
+    JobProc *proc;
+    void *user_data;
+    int job_count;
+    volatile i32 next_job_index;
+};
+
+typedef struct JobWorker JobWorker;
+struct JobWorker
+{
+    JobQueue *queue;
+    int worker_index;
+};
+
+static void
+JobWorkerLoop(JobWorker *worker)
+{
+    JobQueue *queue = worker->queue;
+    for(;;)
+    {
+        int job_index = AtomicIncrementI32(&queue->next_job_index) - 1;
+        if(job_index >= queue->job_count)
+        {
+            break;
+        }
+        queue->proc(queue->user_data, job_index, worker->worker_index);
+    }
+}
+
+static THREAD_PROC(JobWorkerThreadProc)
+{
+    JobWorkerLoop(data);
+    return 0;
+}
+
+static void
+RunJobs(JobProc *proc, void *user_data, int job_count, int worker_count)
+{
+    if(worker_count > job_count)
+    {
+        worker_count = job_count;
+    }
+    
+    if(worker_count <= 1)
+    {
+        for(int i = 0; i < job_count; ++i)
+        {
+            proc(user_data, i, 0);
+        }
+    }
+    else
+    {
+        JobQueue queue = {0};
+        queue.proc = proc;
+        queue.user_data = user_data;
+        queue.job_count = job_count;
+        queue.next_job_index = 0;
+        
+        JobWorker *workers = malloc(sizeof(JobWorker)*worker_count);
+        ThreadHandle *threads = malloc(sizeof(ThreadHandle)*worker_count);
+        for(int i = 0; i < worker_count; ++i)
+        {
+            workers[i].queue = &queue;
+            workers[i].worker_index = i;
+        }
+        for(int i = 1; i < worker_count; ++i)
+        {
+            threads[i] = ThreadLaunch(JobWorkerThreadProc, workers+i);
+        }
+        JobWorkerLoop(workers+0);
+        for(int i = 1; i < worker_count; ++i)
+        {
+            ThreadJoin(threads[i]);
+        }
+        free(threads);
+        free(workers);
+    }
+}
+
 static int
 CharIsAlpha(int c)
 {
@@ -43,12 +297,6 @@ CharIsSymbol(int c)
     return (c == '{' || c == '}' || c == '*' || c == '|' || c == '`');
 }
 
-static int
-CharIsText(int c)
-{
-    return (!CharIsSymbol(c) && c != '@');
-}
-
 static int
 CStringMatchCaseSensitiveN(char *a, char *b, int n)
 {
@@ -91,1890 +339,7024 @@ CStringMatchCaseInsensitive(char *a, char *b)
     return matches;
 }
 
-typedef u32 OutputFlags;
-#define OutputFlag_HTML      (1<<0)
-#define OutputFlag_Markdown  (1<<1)
-#define OutputFlag_BBCode    (1<<2)
+//~ NOTE(rjf): Hashing (64-bit FNV-1a)
 
-typedef enum InputType
-{
-    InputType_RXW,
-    InputType_HTML,
-}
-InputType;
+#define HASH_BEGIN 14695981039346656037ull
 
-typedef enum PageNodeType
+static u64
+HashBytes(u64 hash, void *data, u64 size)
 {
-    PageNodeType_Invalid,
-    PageNodeType_PageTitle,
-    PageNodeType_Title,
-    PageNodeType_SubTitle,
-    PageNodeType_Description,
-    PageNodeType_Text,
-    PageNodeType_ParagraphBreak,
-    PageNodeType_UnorderedList,
-    PageNodeType_OrderedList,
-    PageNodeType_Code,
-    PageNodeType_YouTube,
-    PageNodeType_Image,
-    PageNodeType_ThumbnailImage,
-    PageNodeType_Link,
-    PageNodeType_FeatureButton,
-    PageNodeType_Lister,
-    PageNodeType_Date,
+    u8 *bytes = data;
+    for(u64 i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
 }
-PageNodeType ;
 
-typedef enum CodeLanguageType
+static u64
+HashU64(u64 hash, u64 value)
 {
-    CodeLanguage_None,
-    CodeLanguage_C,
+    return HashBytes(hash, &value, sizeof(value));
 }
-CodeLanguageType;
 
-typedef enum OrderedListStyle
+static u64
+HashCString(u64 hash, char *string)
 {
-    OrderedListStyle_Numeric,
-    OrderedListStyle_Alphabetic,
-    OrderedListStyle_RomanNumeral,
+    // NOTE(rjf): Null and empty strings hash differently, since they emit differently.
+    if(string)
+    {
+        hash = HashBytes(hash, string, CalculateCStringLength(string)+1);
+    }
+    else
+    {
+        hash = HashU64(hash, 0);
+    }
+    return hash;
 }
-OrderedListStyle;
 
-typedef u32 TextStyleFlags;
-#define TextStyleFlag_Bold       (1<<0)
-#define TextStyleFlag_Italics    (1<<1)
-#define TextStyleFlag_Underline  (1<<2)
-#define TextStyleFlag_Monospace  (1<<3)
+//~ NOTE(rjf): Files
+//
+// Input files are handed to the tokenizer as one null-terminated buffer. On POSIX systems,
+// regular files are mapped read-only rather than copied: we reserve an anonymous, zeroed
+// region one byte larger than the file (rounded up to pages), then map the file over the
+// front of it. Bytes past the end of the file in its last page read as zero, and if the file
+// ends exactly on a page boundary the next page is the zeroed reservation, so the terminator
+// is always there. Anything that can't be mapped (pipes, empty files, other platforms) is
+// read into a heap buffer instead.
 
-typedef struct PageNode PageNode;
-struct PageNode
+typedef struct FileData FileData;
+struct FileData
 {
-    PageNodeType type;
-    char *string;
-    int string_length;
-    PageNode *next;
-    TextStyleFlags text_style_flags;
-    PageNode *first_parameter;
-    
-    union
+    char *data;
+    u64 size;
+    u64 mapped_size;
+};
+
+static char *
+ReadEntireStreamAndNullTerminate(FILE *file, u64 *size_out)
+{
+    u64 size = 0;
+    u64 capacity = 64*1024;
+    char *data = malloc(capacity);
+    while(data)
     {
-        struct
+        if(size+1 >= capacity)
         {
-            PageNode *first_item;
-        }
-        unordered_list;
-        
-        struct
-        {
-            OrderedListStyle order_style;
-            PageNode *first_item;
+            capacity *= 2;
+            char *new_data = realloc(data, capacity);
+            if(!new_data)
+            {
+                free(data);
+                data = 0;
+                break;
+            }
+            data = new_data;
         }
-        ordered_list;
-        
-        struct
+        size_t bytes_read = fread(data+size, 1, capacity-size-1, file);
+        if(bytes_read == 0)
         {
-            CodeLanguageType language;
+            data[size] = 0;
+            break;
         }
-        code;
-        
-        struct
+        size += bytes_read;
+    }
+    if(size_out)
+    {
+        *size_out = data ? size : 0;
+    }
+    return data;
+}
+
+static char *
+LoadEntireFileAndNullTerminate(char *filename)
+{
+    char *result = 0;
+    FILE *file = fopen(filename, "rb");
+    if(file)
+    {
+        result = ReadEntireStreamAndNullTerminate(file, 0);
+        fclose(file);
+    }
+    return result;
+}
+
+static FileData
+LoadFileData(char *filename)
+{
+    FileData result = {0};
+    
+#if defined(_WIN32)
+    FILE *file = fopen(filename, "rb");
+    if(file)
+    {
+        result.data = ReadEntireStreamAndNullTerminate(file, &result.size);
+        fclose(file);
+    }
+#else
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if(fd >= 0)
+    {
+        struct stat file_stat = {0};
+        if(fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0)
         {
-            char *url;
-            int url_length;
+            u64 size = (u64)file_stat.st_size;
+            u64 page_size = (u64)sysconf(_SC_PAGESIZE);
+            u64 mapped_size = (size + page_size) & ~(page_size-1);
+            void *reserved = mmap(0, mapped_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(reserved != MAP_FAILED)
+            {
+                void *mapped = mmap(reserved, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+                if(mapped != MAP_FAILED)
+                {
+                    result.data = mapped;
+                    result.size = size;
+                    result.mapped_size = mapped_size;
+                }
+                else
+                {
+                    munmap(reserved, mapped_size);
+                }
+            }
         }
-        link;
         
-        struct
+        if(!result.data)
         {
-            char *image_path;
-            int image_path_length;
-            char *link;
-            int link_length;
+            FILE *file = fdopen(fd, "rb");
+            if(file)
+            {
+                result.data = ReadEntireStreamAndNullTerminate(file, &result.size);
+                fclose(file);
+                fd = -1;
+            }
         }
-        feature_button;
         
-        struct
+        if(fd >= 0)
         {
-            int year;
-            int month;
-            int day;
+            close(fd);
         }
-        date;
-    };
-};
-
-typedef struct Tokenizer Tokenizer;
-struct Tokenizer
-{
-    char *at;
-    int line;
-    char *file;
-    int break_text_by_commas;
-};
-
-#define PARSE_CONTEXT_MEMORY_BLOCK_SIZE_DEFAULT 4096
-typedef struct ParseContextMemoryBlock ParseContextMemoryBlock;
-struct ParseContextMemoryBlock
-{
-    int size;
-    int alloc_position;
-    void *memory;
-    ParseContextMemoryBlock *next;
-};
-
-typedef struct ParseError ParseError;
-struct ParseError
-{
-    char *file;
-    int line;
-    char *message;
-};
-
-typedef struct ParseContext ParseContext;
-struct ParseContext
-{
-    ParseContextMemoryBlock *head;
-    ParseContextMemoryBlock *active;
-    int error_stack_size;
-    int error_stack_size_max;
-    ParseError *error_stack;
-};
+    }
+#endif
+    
+    return result;
+}
 
-static void *
-ParseContextAllocateMemory(ParseContext *context, int size)
+static void
+FreeFileData(FileData *file)
 {
-    void *memory = 0;
-    
-    ParseContextMemoryBlock *chunk = context->active;
-    if(!chunk || chunk->alloc_position + size > chunk->size)
+    if(file->data)
     {
-        ParseContextMemoryBlock *old_chunk = chunk;
-        int needed_bytes = size < PARSE_CONTEXT_MEMORY_BLOCK_SIZE_DEFAULT ? PARSE_CONTEXT_MEMORY_BLOCK_SIZE_DEFAULT : size;
-        chunk = malloc(sizeof(ParseContextMemoryBlock) + needed_bytes);
-        chunk->memory = (char *)chunk + sizeof(ParseContextMemoryBlock);
-        chunk->size = needed_bytes;
-        chunk->alloc_position = 0;
-        chunk->next = 0;
-        if(old_chunk)
+#if defined(_WIN32)
+        free(file->data);
+#else
+        if(file->mapped_size)
         {
-            old_chunk->next = chunk;
+            munmap(file->data, file->mapped_size);
         }
         else
         {
-            context->head = chunk;
+            free(file->data);
         }
-        context->active = chunk;
+#endif
     }
-    
-    memory = (char *)chunk->memory + chunk->alloc_position;
-    chunk->alloc_position += size;
-    return memory;
-}
-
-static char *
-ParseContextAllocateCStringCopy(ParseContext *context, char *str)
-{
-    int needed_bytes = CalculateCStringLength(str)+1;
-    char *str_copy = ParseContextAllocateMemory(context, needed_bytes);
-    MemoryCopy(str_copy, str, needed_bytes);
-    return str_copy;
+    MemorySet(file, 0, sizeof(*file));
 }
 
-static char *
-ParseContextAllocateCStringCopyN(ParseContext *context, char *str, int n)
+// NOTE(rjf): Continues *hash over the file's bytes and adds its size to *size, so that a
+// file's contents can be hashed as part of a larger stream.
+static int
+HashFileContentsInto(char *filename, u64 *hash_out, u64 *size_out)
 {
-    int needed_bytes = n+1;
-    char *str_copy = ParseContextAllocateMemory(context, needed_bytes);
-    MemoryCopy(str_copy, str, needed_bytes);
-    str_copy[n] = 0;
-    return str_copy;
+    int success = 0;
+    FILE *file = fopen(filename, "rb");
+    if(file)
+    {
+        u64 hash = *hash_out;
+        u64 size = *size_out;
+        char chunk[64*1024];
+        for(;;)
+        {
+            size_t bytes_read = fread(chunk, 1, sizeof(chunk), file);
+            if(bytes_read == 0)
+            {
+                break;
+            }
+            hash = HashBytes(hash, chunk, bytes_read);
+            size += bytes_read;
+        }
+        success = !ferror(file);
+        fclose(file);
+        *hash_out = hash;
+        *size_out = size;
+    }
+    return success;
 }
 
-static PageNode *
-ParseContextAllocateNode(ParseContext *context)
+static int
+HashFileContents(char *filename, u64 *hash_out, u64 *size_out)
 {
-    PageNode *node = ParseContextAllocateMemory(context, sizeof(PageNode));
-    MemorySet(node, 0, sizeof(*node));
-    return node;
+    *hash_out = HASH_BEGIN;
+    *size_out = 0;
+    return HashFileContentsInto(filename, hash_out, size_out);
 }
 
-static void
-PushParseError(ParseContext *context, Tokenizer *tokenizer, char *format, ...)
+#if !defined(_WIN32)
+// NOTE(rjf): Copies everything from the input's current position to the output's. On Linux,
+// the copy happens in the kernel with copy_file_range, which also lets file systems that
+// support it share the data rather than copying it. Anything it can't handle (older kernels,
+// copies across file systems) is finished with plain reads and writes.
+static int
+CopyFileDescriptor(int input_fd, int output_fd)
 {
-    if(!context->error_stack)
+    int success = 1;
+    
+#if defined(__linux__)
+    for(;;)
     {
-        context->error_stack_size = 0;
-        context->error_stack_size_max = 32;
-        context->error_stack = ParseContextAllocateMemory(context, sizeof(ParseError)*context->error_stack_size_max);
+        ssize_t bytes_copied = copy_file_range(input_fd, 0, output_fd, 0, 1 << 30, 0);
+        if(bytes_copied <= 0 && !(bytes_copied < 0 && errno == EINTR))
+        {
+            break;
+        }
     }
+#endif
     
-    if(context->error_stack_size < context->error_stack_size_max)
+    char chunk[64*1024];
+    for(;;)
     {
-        va_list args;
-        va_start(args, format);
-        int needed_bytes = vsnprintf(0, 0, format, args)+1;
-        va_end(args);
-        
-        char *message = ParseContextAllocateMemory(context, needed_bytes);
-        
-        va_start(args, format);
-        vsnprintf(message, needed_bytes, format, args);
-        va_end(args);
-        
-        message[needed_bytes-1] = 0;
-        
-        ParseError error = {0};
+        ssize_t bytes_read = read(input_fd, chunk, sizeof(chunk));
+        if(bytes_read < 0 && errno == EINTR)
         {
-            error.file = tokenizer->file;
-            error.line = tokenizer->line;
-            error.message = message;
+            continue;
         }
-        
-        context->error_stack[context->error_stack_size++] = error;
-    }
-}
-
-typedef enum TokenType
-{
-    Token_None,
-    Token_Text,
-    Token_DoubleNewline,
-    Token_Symbol,
-    Token_Tag,
-    Token_StringConstant,
-}
-TokenType;
-
-typedef struct Token Token;
-struct Token
-{
-    TokenType type;
-    char *string;
-    int string_length;
-    int lines_traversed;
-};
-
-static Token
-GetNextTokenFromBuffer(Tokenizer *tokenizer)
-{
-    char *buffer = tokenizer->at;
-    Token token = {0};
-    
-    for(int i = 0; buffer[i]; ++i)
-    {
-        // NOTE(rjf): Newline
-        if(buffer[i] == '\n' && buffer[i+1] == '\n')
+        if(bytes_read <= 0)
         {
-            token.type = Token_DoubleNewline;
-            token.string = buffer+i;
-            token.string_length = 2;
+            success = (bytes_read == 0);
             break;
         }
-        // NOTE(rjf): String Constant
-        else if(buffer[i] == '"')
+        for(ssize_t bytes_written = 0; bytes_written < bytes_read;)
         {
-            token.type = Token_StringConstant;
-            token.string = buffer+i;
-            token.string_length = 0;
-            int escaped = 1;
-            for(; (token.string[token.string_length] != '"' || escaped) && token.string[token.string_length];
-                ++token.string_length)
+            ssize_t result = write(output_fd, chunk + bytes_written, bytes_read - bytes_written);
+            if(result < 0 && errno == EINTR)
             {
-                if(escaped)
-                {
-                    escaped = 0;
-                }
-                else
-                {
-                    if(token.string[token.string_length] == '\\')
-                    {
-                        escaped = 1;
-                    }
-                }
+                continue;
             }
-            
-            ++token.string_length;
-            
+            if(result <= 0)
+            {
+                success = 0;
+                break;
+            }
+            bytes_written += result;
+        }
+        if(!success)
+        {
             break;
         }
-        else if(!CharIsSpace(buffer[i]))
+    }
+    
+    return success;
+}
+#endif
+
+// NOTE(rjf): Copies a file's contents onto the end of an output stream without loading it.
+static int
+AppendFileToStream(FILE *output, char *filename)
+{
+    int success = 0;
+    
+#if defined(_WIN32)
+    FILE *input = fopen(filename, "rb");
+    if(input)
+    {
+        success = 1;
+        char chunk[64*1024];
+        for(;;)
         {
-            int j = 0;
-            
-            // NOTE(rjf): Tag
-            if(buffer[i] == '@')
-            {
-                j = i+1;
-                for(j=i+1; buffer[j] && !CharIsSpace(buffer[j]) && CharIsAlpha(buffer[j]); ++j);
-                token.type = Token_Tag;
-            }
-            
-            // NOTE(rjf): Symbol
-            else if(CharIsSymbol(buffer[i]))
-            {
-                static char *symbolic_blocks_to_break_out[] =
-                {
-                    "*",
-                    "_",
-                    "`",
-                    "{",
-                    "}",
-                    "|",
-                };
-                
-                for(j=i+1; buffer[j] && CharIsSymbol(buffer[j]); ++j);
-                token.type = Token_Symbol;
-                
-                for(int k = 0; k < sizeof(symbolic_blocks_to_break_out)/sizeof(symbolic_blocks_to_break_out[0]);
-                    ++k)
-                {
-                    int length_to_compare = CalculateCStringLength(symbolic_blocks_to_break_out[k]);
-                    if(CStringMatchCaseSensitiveN(symbolic_blocks_to_break_out[k], buffer+i, length_to_compare))
-                    {
-                        j = i+length_to_compare;
-                        break;
-                    }
-                }
-            }
-            
-            // NOTE(rjf): Text
-            else
+            size_t bytes_read = fread(chunk, 1, sizeof(chunk), input);
+            if(bytes_read == 0)
             {
-                for(j=i+1;
-                    buffer[j] &&
-                    CharIsText(buffer[j]) &&
-                    buffer[j] != '\n' &&
-                    (!tokenizer->break_text_by_commas ||
-                     buffer[j] != ','); ++j);
-                token.type = Token_Text;
-                
-                // NOTE(rjf): Add skipped whitespace to text node
-                for(; i > 0 && CharIsSpace(buffer[i-1]); --i);
+                success = !ferror(input);
+                break;
             }
-            
-            if(j != 0)
+            if(fwrite(chunk, 1, bytes_read, output) != bytes_read)
             {
-                token.string = buffer+i;
-                token.string_length = j-i;
+                success = 0;
                 break;
             }
         }
+        fclose(input);
     }
-    
-    for(int i = 0; i < token.string_length; ++i)
+#else
+    int input_fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if(input_fd >= 0)
     {
-        if(token.string[i] == '\n')
-        {
-            ++token.lines_traversed;
-        }
+        fflush(output);
+        success = CopyFileDescriptor(input_fd, fileno(output));
+        close(input_fd);
     }
+#endif
     
-    return token;
+    return success;
 }
 
-static Token
-PeekToken(Tokenizer *tokenizer)
+typedef struct FileInfo FileInfo;
+struct FileInfo
 {
-    Token token = GetNextTokenFromBuffer(tokenizer);
-    return token;
-}
+    int exists;
+    int is_directory;
+    u64 size;
+    
+    // NOTE(rjf): Nanoseconds on POSIX, 100ns ticks on Windows. Only ever compared or copied.
+    u64 modified_time;
+};
 
-static Token
-NextToken(Tokenizer *tokenizer)
+static FileInfo
+GetFileInfo(char *path)
 {
-    Token token = GetNextTokenFromBuffer(tokenizer);
-    tokenizer->at = token.string + token.string_length;
-    tokenizer->line += token.lines_traversed;
-    return token;
+    FileInfo info = {0};
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA data = {0};
+    if(GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+    {
+        info.exists = 1;
+        info.is_directory = !!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+        info.size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        info.modified_time = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    }
+#else
+    struct stat status = {0};
+    if(stat(path, &status) == 0)
+    {
+        info.exists = 1;
+        info.is_directory = S_ISDIR(status.st_mode);
+        info.size = (u64)status.st_size;
+#if defined(__APPLE__)
+        info.modified_time = (u64)status.st_mtimespec.tv_sec*1000000000ull + (u64)status.st_mtimespec.tv_nsec;
+#else
+        info.modified_time = (u64)status.st_mtim.tv_sec*1000000000ull + (u64)status.st_mtim.tv_nsec;
+#endif
+    }
+#endif
+    return info;
 }
 
 static int
-RequireTokenType(Tokenizer *tokenizer, TokenType type, Token *token_ptr)
+SetFileModifiedTime(char *path, u64 modified_time)
 {
-    int match = 0;
-    Token token = GetNextTokenFromBuffer(tokenizer);
-    if(token.type == type)
+    int success = 0;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(file != INVALID_HANDLE_VALUE)
     {
-        match = 1;
-        if(token_ptr)
-        {
-            *token_ptr = token;
-        }
-        tokenizer->at = token.string + token.string_length;
-        tokenizer->line += token.lines_traversed;
+        FILETIME time = {0};
+        time.dwLowDateTime = (DWORD)modified_time;
+        time.dwHighDateTime = (DWORD)(modified_time >> 32);
+        success = !!SetFileTime(file, 0, 0, &time);
+        CloseHandle(file);
     }
-    return match;
+#else
+    struct timespec times[2] = {0};
+    times[0].tv_nsec = UTIME_OMIT;
+    times[1].tv_sec = (time_t)(modified_time / 1000000000ull);
+    times[1].tv_nsec = (long)(modified_time % 1000000000ull);
+    success = (utimensat(AT_FDCWD, path, times, 0) == 0);
+#endif
+    return success;
 }
 
+// NOTE(rjf): Succeeds if the directory already exists.
 static int
-TokenMatch(Token token, char *string)
+MakeDirectory(char *path)
 {
-    return (token.type != Token_None &&
-            CStringMatchCaseSensitiveN(token.string, string, token.string_length) &&
-            string[token.string_length] == 0);
+#if defined(_WIN32)
+    return CreateDirectoryA(path, 0) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
 }
 
+// NOTE(rjf): Moves a file over another one, replacing it in one step, so that anything reading
+// the destination sees either the old file or the new one, never a mix.
 static int
-RequireToken(Tokenizer *tokenizer, char *string, Token *token_ptr)
+RenameFileReplacing(char *source, char *destination)
 {
-    int match = 0;
-    Token token = GetNextTokenFromBuffer(tokenizer);
-    if(TokenMatch(token, string))
+#if defined(_WIN32)
+    return !!MoveFileExA(source, destination, MOVEFILE_REPLACE_EXISTING);
+#else
+    return rename(source, destination) == 0;
+#endif
+}
+
+// NOTE(rjf): Makes every directory leading up to the last path separator.
+static void
+MakeParentDirectories(char *path)
+{
+    char *parent = strdup(path);
+    for(char *at = parent+1; *at; ++at)
     {
-        match = 1;
-        if(token_ptr)
+        if(*at == '/' || *at == '\\')
         {
-            *token_ptr = token;
+            char separator = *at;
+            *at = 0;
+            MakeDirectory(parent);
+            *at = separator;
         }
-        tokenizer->at = token.string + token.string_length;
-        tokenizer->line += token.lines_traversed;
     }
-    return match;
+    free(parent);
 }
 
-static void
-SkipToAfterNextComma(Tokenizer *tokenizer)
+// NOTE(rjf): Returns the names of everything in a directory, other than "." and "..", as one
+// allocation that the caller frees.
+static char **
+ListDirectory(char *path, int *count_out)
 {
-    for(int i = 0; tokenizer->at[i]; ++i)
+    int count = 0;
+    int capacity = 0;
+    char **names = 0;
+    
+#if defined(_WIN32)
+    char pattern[1024] = {0};
+    snprintf(pattern, sizeof(pattern), "%s\\*", path);
+    WIN32_FIND_DATAA data = {0};
+    HANDLE find = FindFirstFileA(pattern, &data);
+    if(find != INVALID_HANDLE_VALUE)
     {
-        if(tokenizer->at[i] == ',')
+        do
         {
-            tokenizer->at += i+1;
-            break;
+            char *name = data.cFileName;
+#else
+    DIR *directory = opendir(path);
+    if(directory)
+    {
+        for(struct dirent *entry = readdir(directory); entry; entry = readdir(directory))
+        {
+            char *name = entry->d_name;
+#endif
+            if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+            {
+                continue;
+            }
+            if(count >= capacity)
+            {
+                capacity = capacity ? capacity*2 : 64;
+                names = realloc(names, sizeof(char *)*capacity);
+            }
+            names[count++] = strdup(name);
+#if defined(_WIN32)
+        }
+        while(FindNextFileA(find, &data));
+        FindClose(find);
+    }
+#else
         }
+        closedir(directory);
     }
+#endif
+    
+    *count_out = count;
+    return names;
 }
 
-static void
-TrimQuotationMarks(char **text, int *text_length)
+// NOTE(rjf): Copies a file, and gives the copy the original's modification time, so that a
+// later sync can tell that it is unchanged from its size and time alone. On Linux, the copy
+// is a reflink (FICLONE) where the file system supports it, which shares the data instead of
+// copying it.
+static int
+CopyFileKeepingModifiedTime(char *source, char *destination, u64 modified_time)
 {
-    if(*text[0] == '"')
+    int success = 0;
+#if defined(_WIN32)
+    success = !!CopyFileA(source, destination, FALSE);
+    (void)modified_time;
+#else
+    int input_fd = open(source, O_RDONLY | O_CLOEXEC);
+    if(input_fd >= 0)
     {
-        *text = *text + 1;
-        *text_length -= 2;
+        int output_fd = open(destination, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(output_fd >= 0)
+        {
+#if defined(FICLONE)
+            success = (ioctl(output_fd, FICLONE, input_fd) == 0);
+#endif
+            if(!success)
+            {
+                success = CopyFileDescriptor(input_fd, output_fd);
+            }
+            success = (close(output_fd) == 0) && success;
+        }
+        close(input_fd);
     }
+    if(success)
+    {
+        success = SetFileModifiedTime(destination, modified_time);
+    }
+#endif
+    return success;
 }
 
-static int
-ParseTextArgument(ParseContext *context, Tokenizer *tokenizer, char **text, int *text_length)
+//~ NOTE(rjf): Output Buffers
+//
+// Pages are built up in memory and written out with a single fwrite, rather than going
+// through a formatted print for every tag and character. Each worker owns one buffer and
+// reuses its storage for every page it emits, so after the first few pages, emission
+// doesn't allocate at all.
+
+typedef struct HTMLMinifier HTMLMinifier;
+
+typedef struct OutputBuffer OutputBuffer;
+struct OutputBuffer
 {
-    int found_Link = 0;
-    Token link_Tag = {0};
-    if(RequireTokenType(tokenizer, Token_StringConstant, &link_Tag) ||
-       RequireTokenType(tokenizer, Token_Text, &link_Tag))
+    char *data;
+    u64 size;
+    u64 capacity;
+
+    // NOTE(rjf): When set, everything appended goes through the minifier on its way in.
+    HTMLMinifier *minifier;
+};
+
+static void
+OutputBufferReserve(OutputBuffer *buffer, u64 size)
+{
+    if(buffer->size + size > buffer->capacity)
     {
-        *text = link_Tag.string;
-        *text_length = link_Tag.string_length;
-        if(*text[0] == '"')
+        u64 new_capacity = buffer->capacity ? buffer->capacity : 64*1024;
+        while(new_capacity < buffer->size + size)
         {
-            *text = *text + 1;
-            *text_length -= 2;
+            new_capacity *= 2;
         }
-        found_Link = 1;
+        buffer->data = realloc(buffer->data, new_capacity);
+        buffer->capacity = new_capacity;
     }
-    return found_Link;
 }
 
+static void
+OutputBufferWriteN(OutputBuffer *buffer, char *string, u64 length)
+{
+    OutputBufferReserve(buffer, length);
+    MemoryCopy(buffer->data + buffer->size, string, length);
+    buffer->size += length;
+}
+
+// NOTE(rjf): HTML minification, for --minify. This is a filter on the bytes appended to an
+// output buffer, so it runs as pages are emitted, with no extra pass over them, and it carries
+// its state across appends, since a tag can be split over any number of them. It:
+//
+//   - collapses each run of whitespace in text to one space, and drops it entirely outside
+//     <body>, where it never renders,
+//   - collapses whitespace between attributes, and drops it before a tag's '>',
+//   - removes comments, except conditional ones (<!--[if ...),
+//   - leaves <pre>, <textarea>, <script> and <style> contents exactly as they were.
+//
+// Whitespace between elements in <body> is kept (as one space), since it is visible between
+// inline and inline-block elements.
+
+#define HTML_MINIFIER_TAG_NAME_SIZE 16
+
+typedef enum HTMLMinifierState
+{
+    HTMLMinifierState_Text,
+    HTMLMinifierState_TagName,
+    HTMLMinifierState_Tag,
+    HTMLMinifierState_AttributeValue,
+    HTMLMinifierState_Comment,
+    HTMLMinifierState_Raw,
+}
+HTMLMinifierState;
+
+struct HTMLMinifier
+{
+    HTMLMinifierState state;
+    int in_body;
+    int pending_space;
+    char last_written;
+    char quote;
+
+    // NOTE(rjf): The tag being read. Nothing of it is written until its name is complete,
+    // because the name decides what happens to the whitespace in front of it.
+    char tag_name[HTML_MINIFIER_TAG_NAME_SIZE];
+    int tag_name_length;
+
+    // NOTE(rjf): For comments, the number of '-' in a row; for raw elements, how much of the
+    // closing tag ("</pre") has been matched so far.
+    int match_length;
+    char raw_end[HTML_MINIFIER_TAG_NAME_SIZE+2];
+    int raw_end_length;
+};
+
 static int
-ParseLink(ParseContext *context, Tokenizer *tokenizer, char **link, int *link_length)
+CharIsHTMLSpace(char c)
 {
-    return ParseTextArgument(context, tokenizer, link, link_length);
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
 }
 
-static PageNode *
-ParseText(ParseContext *context, Tokenizer *tokenizer)
+static char
+CharToLower(char c)
 {
-    PageNode *result = 0;
-    
-    Token token = PeekToken(tokenizer);
-    int text_style_flags = 0;
-    
-    PageNode **node_store_target = &result;
-    
-    while(token.type != Token_None)
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static void
+HTMLMinifierWrite(HTMLMinifier *minifier, OutputBuffer *buffer, char *string, u64 length)
+{
+    if(length)
     {
-        Token tag = {0};
-        Token symbol = {0};
-        Token text = {0};
-        
-        if(RequireTokenType(tokenizer, Token_Tag, &tag))
-        {
-            
-            if(TokenMatch(tag, "@PageTitle"))
-            {
-                Token title_Text = {0};
-                
-                if(RequireToken(tokenizer, "{", 0))
-                {
-                    if(RequireTokenType(tokenizer, Token_Text, &title_Text) ||
-                       RequireTokenType(tokenizer, Token_StringConstant, &title_Text))
-                    {
-                        PageNode *node = ParseContextAllocateNode(context);
-                        node->type = PageNodeType_PageTitle;
-                        node->string = title_Text.string;
-                        node->string_length = title_Text.string_length;
-                        TrimQuotationMarks(&node->string, &node->string_length);
-                        node->text_style_flags = text_style_flags;
-                        *node_store_target = node;
-                        node_store_target = &(*node_store_target)->next;
-                    }
-                    else
-                    {
-                        PushParseError(context, tokenizer, "A page title tag expects {<title text>} to follow.");
-                    }
-                    
-                    if(!RequireToken(tokenizer, "}", 0))
-                    {
-                        PushParseError(context, tokenizer, "Missing '}'.");
-                    }
-                }
-                else
-                {
-                    PushParseError(context, tokenizer, "Expected '{'.");
-                }
-            }
-            
-            else if(TokenMatch(tag, "@Title"))
+        OutputBufferWriteN(buffer, string, length);
+        minifier->last_written = string[length-1];
+    }
+}
+
+static void
+HTMLMinifierFlushTagSpace(HTMLMinifier *minifier, OutputBuffer *buffer)
+{
+    if(minifier->pending_space)
+    {
+        HTMLMinifierWrite(minifier, buffer, " ", 1);
+        minifier->pending_space = 0;
+    }
+}
+
+// NOTE(rjf): Outside <body>, whitespace only matters between words (e.g. in <title>).
+static void
+HTMLMinifierFlushSpace(HTMLMinifier *minifier, OutputBuffer *buffer, int before_tag)
+{
+    if(minifier->pending_space && minifier->last_written &&
+       (minifier->in_body || (!before_tag && minifier->last_written != '>')))
+    {
+        HTMLMinifierWrite(minifier, buffer, " ", 1);
+    }
+    minifier->pending_space = 0;
+}
+
+static int
+HTMLTagNameMatches(HTMLMinifier *minifier, char *name)
+{
+    int matches = 1;
+    int i = 0;
+    for(; name[i]; ++i)
+    {
+        if(i >= minifier->tag_name_length || CharToLower(minifier->tag_name[i]) != name[i])
+        {
+            matches = 0;
+            break;
+        }
+    }
+    return matches && i == minifier->tag_name_length;
+}
+
+// NOTE(rjf): Called once a tag's name has been read, with the character that ended it still
+// to be processed.
+static void
+HTMLMinifierBeginTag(HTMLMinifier *minifier, OutputBuffer *buffer)
+{
+    // NOTE(rjf): Most tags are none of the ones we care about, and the first letter says so.
+    char first = CharToLower(minifier->tag_name[0]);
+    int closing = (first == '/');
+    if(closing && (HTMLTagNameMatches(minifier, "/body") || HTMLTagNameMatches(minifier, "/html")))
+    {
+        minifier->in_body = 0;
+    }
+    HTMLMinifierFlushSpace(minifier, buffer, 1);
+    if(first == 'b' && HTMLTagNameMatches(minifier, "body"))
+    {
+        minifier->in_body = 1;
+    }
+
+    OutputBufferReserve(buffer, 1 + minifier->tag_name_length);
+    buffer->data[buffer->size++] = '<';
+    HTMLMinifierWrite(minifier, buffer, minifier->tag_name, minifier->tag_name_length);
+
+    minifier->raw_end_length = 0;
+    static char *raw_elements[] = { "pre", "textarea", "script", "style" };
+    for(int i = 0; !closing && i < (int)(sizeof(raw_elements)/sizeof(raw_elements[0])); ++i)
+    {
+        if(first == raw_elements[i][0] && HTMLTagNameMatches(minifier, raw_elements[i]))
+        {
+            minifier->raw_end[0] = '<';
+            minifier->raw_end[1] = '/';
+            MemoryCopy(minifier->raw_end + 2, raw_elements[i], CalculateCStringLength(raw_elements[i]));
+            minifier->raw_end_length = 2 + (int)CalculateCStringLength(raw_elements[i]);
+            break;
+        }
+    }
+    minifier->state = HTMLMinifierState_Tag;
+}
+
+static void
+MinifyHTML(HTMLMinifier *minifier, OutputBuffer *buffer, char *string, u64 length)
+{
+    for(u64 i = 0; i < length;)
+    {
+        char c = string[i];
+        switch(minifier->state)
+        {
+            case HTMLMinifierState_Text:
             {
-                Token title_Text = {0};
-                
-                if(RequireToken(tokenizer, "{", 0))
+                if(CharIsHTMLSpace(c))
                 {
-                    if(RequireTokenType(tokenizer, Token_Text, &title_Text) ||
-                       RequireTokenType(tokenizer, Token_StringConstant, &title_Text))
-                    {
-                        PageNode *node = ParseContextAllocateNode(context);
-                        node->type = PageNodeType_Title;
-                        node->string = title_Text.string;
-                        node->string_length = title_Text.string_length;
-                        TrimQuotationMarks(&node->string, &node->string_length);
-                        node->text_style_flags = text_style_flags;
-                        *node_store_target = node;
-                        node_store_target = &(*node_store_target)->next;
-                    }
-                    else
-                    {
-                        PushParseError(context, tokenizer, "A title tag expects {<title text>} to follow.");
-                    }
-                    
-                    if(!RequireToken(tokenizer, "}", 0))
-                    {
-                        PushParseError(context, tokenizer, "Missing '}'.");
-                    }
+                    minifier->pending_space = 1;
+                    ++i;
                 }
-                else
+                else if(c == '<')
                 {
-                    PushParseError(context, tokenizer, "Expected '{'.");
+                    minifier->state = HTMLMinifierState_TagName;
+                    minifier->tag_name_length = 0;
+                    ++i;
                 }
-            }
-            
-            else if(TokenMatch(tag, "@SubTitle"))
-            {
-                Token title_Text = {0};
-                
-                if(RequireToken(tokenizer, "{", 0))
+                else
                 {
-                    if(RequireTokenType(tokenizer, Token_Text, &title_Text) ||
-                       RequireTokenType(tokenizer, Token_StringConstant, &title_Text))
+                    // NOTE(rjf): Single spaces between words in <body> are already minimal, so
+                    // they're copied along with the words around them.
+                    HTMLMinifierFlushSpace(minifier, buffer, 0);
+                    u64 run_end = i+1;
+                    for(; run_end < length && string[run_end] != '<'; ++run_end)
                     {
-                        PageNode *node = ParseContextAllocateNode(context);
-                        node->type = PageNodeType_SubTitle;
-                        node->string = title_Text.string;
-                        node->string_length = title_Text.string_length;
-                        TrimQuotationMarks(&node->string, &node->string_length);
-                        node->text_style_flags = text_style_flags;
-                        *node_store_target = node;
-                        node_store_target = &(*node_store_target)->next;
-                    }
-                    else
-                    {
-                        PushParseError(context, tokenizer, "A sub-title tag expects {<sub-title text>} to follow.");
-                    }
-                    
-                    if(!RequireToken(tokenizer, "}", 0))
-                    {
-                        PushParseError(context, tokenizer, "Missing '}'.");
+                        if(CharIsHTMLSpace(string[run_end]) &&
+                           !(minifier->in_body && string[run_end] == ' ' && run_end+1 < length &&
+                             !CharIsHTMLSpace(string[run_end+1])))
+                        {
+                            break;
+                        }
                     }
+                    HTMLMinifierWrite(minifier, buffer, string + i, run_end - i);
+                    i = run_end;
                 }
-                else
-                {
-                    PushParseError(context, tokenizer, "Expected '{'.");
-                }
-            }
-            
-            else if(TokenMatch(tag, "@Description"))
+            }break;
+
+            case HTMLMinifierState_TagName:
             {
-                Token text = {0};
-                
-                if(RequireToken(tokenizer, "{", 0))
+                int is_name_char = ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                                    c == '!' || c == '-' || (c == '/' && minifier->tag_name_length == 0));
+                if(minifier->tag_name_length == 3 && minifier->tag_name[0] == '!' &&
+                   minifier->tag_name[1] == '-' && minifier->tag_name[2] == '-' && c != '[')
                 {
-                    if(RequireTokenType(tokenizer, Token_Text, &text) ||
-                       RequireTokenType(tokenizer, Token_StringConstant, &text))
-                    {
-                        PageNode *node = ParseContextAllocateNode(context);
-                        node->type = PageNodeType_Description;
-                        node->string = text.string;
-                        node->string_length = text.string_length;
-                        TrimQuotationMarks(&node->string, &node->string_length);
-                        node->text_style_flags = text_style_flags;
-                        *node_store_target = node;
-                        node_store_target = &(*node_store_target)->next;
-                    }
-                    else
-                    {
-                        PushParseError(context, tokenizer, "A description tag expects {<description text>} to follow.");
-                    }
-                    
-                    if(!RequireToken(tokenizer, "}", 0))
-                    {
-                        PushParseError(context, tokenizer, "Missing '}'.");
-                    }
+                    minifier->state = HTMLMinifierState_Comment;
+                    minifier->match_length = 0;
                 }
-                else
+                else if(is_name_char && minifier->tag_name_length < HTML_MINIFIER_TAG_NAME_SIZE)
                 {
-                    PushParseError(context, tokenizer, "Expected '{'.");
+                    minifier->tag_name[minifier->tag_name_length++] = c;
+                    ++i;
                 }
-            }
-            
-            else if(TokenMatch(tag, "@YouTube"))
-            {
-                if(RequireToken(tokenizer, "{", 0))
+                else if(minifier->tag_name_length == 0)
                 {
-                    PageNode *node = ParseContextAllocateNode(context);
-                    node->type = PageNodeType_YouTube;
-                    node->text_style_flags = text_style_flags;
-                    *node_store_target = node;
-                    node_store_target = &(*node_store_target)->next;
-                    
-                    if(ParseLink(context, tokenizer, &node->string, &node->string_length))
-                    {
-                        if(!RequireToken(tokenizer, "}", 0))
-                        {
-                            PushParseError(context, tokenizer, "Missing '}'.");
-                        }
-                    }
-                    else
-                    {
-                        PushParseError(context, tokenizer, "A YouTube tag expects {<youtube link>} to follow.");
-                    }
+                    // NOTE(rjf): A '<' that doesn't start a tag is just text.
+                    HTMLMinifierFlushSpace(minifier, buffer, 0);
+                    HTMLMinifierWrite(minifier, buffer, "<", 1);
+                    minifier->state = HTMLMinifierState_Text;
                 }
                 else
                 {
-                    PushParseError(context, tokenizer, "Expected '{'.");
+                    HTMLMinifierBeginTag(minifier, buffer);
                 }
-            }
-            
-            else if(TokenMatch(tag, "@Image") || TokenMatch(tag, "@ThumbnailImage"))
+            }break;
+
+            case HTMLMinifierState_Tag:
             {
-                if(RequireToken(tokenizer, "{", 0))
+                if(CharIsHTMLSpace(c))
                 {
-                    PageNode *node = ParseContextAllocateNode(context);
-                    node->type = TokenMatch(tag, "@Image") ? PageNodeType_Image : PageNodeType_ThumbnailImage;
-                    node->text_style_flags = text_style_flags;
-                    *node_store_target = node;
-                    node_store_target = &(*node_store_target)->next;
-                    
-                    if(ParseLink(context, tokenizer, &node->string, &node->string_length))
-                    {
-                        if(!RequireToken(tokenizer, "}", 0))
-                        {
-                            PushParseError(context, tokenizer, "Missing '}'.");
-                        }
-                    }
-                    else
-                    {
-                        PushParseError(context, tokenizer, "An image tag expects {<image link>} to follow.");
-                    }
+                    minifier->pending_space = 1;
                 }
-                else
+                else if(c == '>')
                 {
-                    PushParseError(context, tokenizer, "Expected '{'.");
+                    minifier->pending_space = 0;
+                    HTMLMinifierWrite(minifier, buffer, ">", 1);
+                    minifier->state = minifier->raw_end_length ? HTMLMinifierState_Raw : HTMLMinifierState_Text;
+                    minifier->match_length = 0;
                 }
-            }
-            
-            else if(TokenMatch(tag, "@Code"))
-            {
-                Token open_bracket = {0};
-                if(RequireToken(tokenizer, "{", &open_bracket))
+                else if(c == '"' || c == '\'')
                 {
-                    char *link = open_bracket.string+1;
-                    int link_length = 0;
-                    
-                    int bracket_stack = 1;
-                    for(int i = 0; link[i]; ++i)
-                    {
-                        if(link[i] == '{')
-                        {
-                            ++bracket_stack;
-                        }
-                        else if(link[i] == '}')
-                        {
-                            --bracket_stack;
-                        }
-                        
-                        if(bracket_stack == 0)
-                        {
-                            break;
-                        }
-                        
-                        ++link_length;
-                    }
-                    
-                    PageNode *node = ParseContextAllocateNode(context);
-                    node->type = PageNodeType_Code;
-                    node->string = link;
-                    node->string_length = link_length;
-                    node->text_style_flags = text_style_flags;
-                    *node_store_target = node;
-                    node_store_target = &(*node_store_target)->next;
-                    
-                    tokenizer->at = link + link_length;
-                    if(!RequireToken(tokenizer, "}", 0))
-                    {
-                        PushParseError(context, tokenizer, "Expected } to follow code block.");
-                    }
+                    HTMLMinifierFlushTagSpace(minifier, buffer);
+                    HTMLMinifierWrite(minifier, buffer, &c, 1);
+                    minifier->quote = c;
+                    minifier->state = HTMLMinifierState_AttributeValue;
                 }
                 else
                 {
-                    PushParseError(context, tokenizer, "A code tag expects {<code>} to follow.");
-                }
-            }
-            
-            else if(TokenMatch(tag, "@Link"))
-            {
-                if(RequireToken(tokenizer, "{", 0))
-                {
-                    PageNode *node = ParseContextAllocateNode(context);
-                    node->type = PageNodeType_Link;
-                    node->text_style_flags = text_style_flags;
-                    *node_store_target = node;
-                    node_store_target = &(*node_store_target)->next;
-                    
-                    if(!ParseTextArgument(context, tokenizer, &node->string, &node->string_length))
-                    {
-                        PushParseError(context, tokenizer, "A link tag expects {<text>, <link>} to follow.");
-                        goto end_Link_parse;
-                    }
-                    SkipToAfterNextComma(tokenizer);
-                    
-                    if(!ParseLink(context, tokenizer, &node->link.url, &node->link.url_length))
+                    HTMLMinifierFlushTagSpace(minifier, buffer);
+                    u64 run_end = i+1;
+                    while(run_end < length && !CharIsHTMLSpace(string[run_end]) && string[run_end] != '>' &&
+                          string[run_end] != '"' && string[run_end] != '\'')
                     {
-                        PushParseError(context, tokenizer, "A link tag expects {<text>, <link>} to follow.");
-                        goto end_Link_parse;
+                        ++run_end;
                     }
-                    
-                    if(!RequireToken(tokenizer, "}", 0))
-                    {
-                        PushParseError(context, tokenizer, "Missing '}'.");
-                    }
-                    
-                    end_Link_parse:;
+                    HTMLMinifierWrite(minifier, buffer, string + i, run_end - i);
+                    i = run_end - 1;
                 }
-                else
-                {
-                    PushParseError(context, tokenizer, "Expected '{'.");
-                }
-            }
-            
-            else if(TokenMatch(tag, "@FeatureButton"))
+                ++i;
+            }break;
+
+            case HTMLMinifierState_AttributeValue:
             {
-                if(RequireToken(tokenizer, "{", 0))
+                u64 run_end = i;
+                while(run_end < length && string[run_end] != minifier->quote)
                 {
-                    PageNode *node = ParseContextAllocateNode(context);
-                    node->type = PageNodeType_FeatureButton;
-                    node->text_style_flags = text_style_flags;
-                    *node_store_target = node;
-                    node_store_target = &(*node_store_target)->next;
-                    
-                    if(!ParseTextArgument(context, tokenizer, &node->feature_button.image_path, &node->feature_button.image_path_length))
-                    {
-                        PushParseError(context, tokenizer, "A feature button tag expects {<image>, <text>, <link>} to follow.");
-                        goto end_FeatureButton_parse;
-                    }
-                    
-                    SkipToAfterNextComma(tokenizer);
-                    
-                    if(!ParseLink(context, tokenizer, &node->string, &node->string_length))
-                    {
-                        PushParseError(context, tokenizer, "A feature button tag expects {<image>, <text>, <link>} to follow.");
-                        goto end_FeatureButton_parse;
-                    }
-                    
-                    SkipToAfterNextComma(tokenizer);
-                    
-                    if(!ParseLink(context, tokenizer, &node->feature_button.link, &node->feature_button.link_length))
-                    {
-                        PushParseError(context, tokenizer, "A feature button tag expects {<image>, <text>, <link>} to follow.");
-                        goto end_FeatureButton_parse;
-                    }
-                    
-                    if(!RequireToken(tokenizer, "}", 0))
-                    {
-                        PushParseError(context, tokenizer, "Missing '}'.");
-                    }
-                    
-                    end_FeatureButton_parse:;
+                    ++run_end;
                 }
-                else
+                if(run_end < length)
                 {
-                    PushParseError(context, tokenizer, "Expected '{'.");
+                    ++run_end;
+                    minifier->state = HTMLMinifierState_Tag;
                 }
-            }
-            
-            else if(TokenMatch(tag, "@Lister"))
+                HTMLMinifierWrite(minifier, buffer, string + i, run_end - i);
+                i = run_end;
+            }break;
+
+            case HTMLMinifierState_Comment:
             {
-                Token open_bracket = {0};
-                if(RequireToken(tokenizer, "{", &open_bracket))
-                {
-                    
-                    char *text = 0;
-                    int text_length = 0;
-                    
-                    text = open_bracket.string+1;
-                    for(int i = 0; text[i]; ++i)
-                    {
-                        if(text[i] == '"')
-                        {
-                            text = text+i+1;
-                            break;
-                        }
-                    }
-                    for(text_length = 0; text[text_length] && text[text_length] != '"'; ++text_length);
-                    
-                    PageNode *node = ParseContextAllocateNode(context);
-                    node->type = PageNodeType_Lister;
-                    node->string = text;
-                    node->string_length = text_length;
-                    node->text_style_flags = text_style_flags;
-                    *node_store_target = node;
-                    node_store_target = &(*node_store_target)->next;
-                    
-                    tokenizer->at = text + text_length+1;
-                    if(!RequireToken(tokenizer, "}", 0))
-                    {
-                        PushParseError(context, tokenizer, "Expected } to follow lister data.");
-                    }
-                }
-                else
+                if(c == '>' && minifier->match_length >= 2)
                 {
-                    PushParseError(context, tokenizer, "A FeatureButton tag expects {<image>,<string>,<link>} to follow.");
+                    minifier->state = HTMLMinifierState_Text;
                 }
-            }
-            
-            else if(TokenMatch(tag, "@Date"))
+                minifier->match_length = (c == '-') ? minifier->match_length + 1 : 0;
+                ++i;
+            }break;
+
+            case HTMLMinifierState_Raw:
             {
-                Token open_bracket = {0};
-                if(RequireToken(tokenizer, "{", &open_bracket))
+                // NOTE(rjf): Copied through untouched up to the closing tag, which is then read
+                // like any other tag.
+                u64 run_end = i;
+                while(run_end < length)
                 {
-                    int year = 0;
-                    int month = 0;
-                    int day = 0;
-                    
-                    char *str = open_bracket.string+1;
-                    
-                    for(int i = 0; str[i]; ++i)
-                    {
-                        if(CharIsDigit(str[i]))
-                        {
-                            char num_str[32] = {0};
-                            int j = 0;
-                            for(; str[i+j] && j < sizeof(num_str) && CharIsDigit(str[j]); ++j)
-                            {
-                                num_str[j] = str[i+j];
-                            }
-                            year = CStringToInt(num_str);
-                            str += i+j+1;
-                            break;
-                        }
-                    }
-                    
-                    for(int i = 0; str[i]; ++i)
+                    if(minifier->match_length == 0)
                     {
-                        if(CharIsDigit(str[i]))
+                        char *next_tag = memchr(string + run_end, '<', length - run_end);
+                        if(!next_tag)
                         {
-                            char num_str[32] = {0};
-                            int j = 0;
-                            for(; str[i+j] && j < sizeof(num_str) && CharIsDigit(str[j]); ++j)
-                            {
-                                num_str[j] = str[i+j];
-                            }
-                            month = CStringToInt(num_str);
-                            str += i+j+1;
+                            run_end = length;
                             break;
                         }
+                        run_end = (u64)(next_tag - string);
                     }
-                    
-                    for(int i = 0; str[i]; ++i)
+                    char raw_c = CharToLower(string[run_end]);
+                    ++run_end;
+                    if(raw_c == minifier->raw_end[minifier->match_length])
                     {
-                        if(CharIsDigit(str[i]))
+                        if(++minifier->match_length == minifier->raw_end_length)
                         {
-                            char num_str[32] = {0};
-                            int j = 0;
-                            for(; str[i+j] && j < sizeof(num_str) && CharIsDigit(str[j]); ++j)
-                            {
-                                num_str[j] = str[i+j];
-                            }
-                            day = CStringToInt(num_str);
-                            str += i+j;
+                            minifier->raw_end_length = 0;
+                            minifier->state = HTMLMinifierState_Tag;
                             break;
                         }
                     }
-                    
-                    PageNode *node = ParseContextAllocateNode(context);
-                    node->type = PageNodeType_Date;
-                    node->string = "";
-                    node->string_length = 0;
-                    node->date.year = year;
-                    node->date.month = month;
-                    node->date.day = day;
-                    node->text_style_flags = text_style_flags;
-                    *node_store_target = node;
-                    node_store_target = &(*node_store_target)->next;
-                    
-                    tokenizer->at = str;
-                    if(!RequireToken(tokenizer, "}", 0))
+                    else
                     {
-                        PushParseError(context, tokenizer, "Expected '}' to follow date data.");
+                        minifier->match_length = (raw_c == '<') ? 1 : 0;
                     }
                 }
-                else
-                {
-                    PushParseError(context, tokenizer, "A FeatureButton tag expects {<image>,<string>,<link>} to follow.");
-                }
-            }
-            
-            else
-            {
-                PushParseError(context, tokenizer, "Malformed tag.");
-            }
-            
-        }
-        else if(RequireTokenType(tokenizer, Token_Text, &text))
-        {
-            PageNode *node = ParseContextAllocateNode(context);
-            node->type = PageNodeType_Text;
-            node->string = text.string;
-            node->string_length = text.string_length;
-            node->text_style_flags = text_style_flags;
-            *node_store_target = node;
-            node_store_target = &(*node_store_target)->next;
-        }
-        else if(RequireTokenType(tokenizer, Token_Symbol, &symbol))
-        {
-            if(TokenMatch(symbol, "*"))
-            {
-                text_style_flags ^= TextStyleFlag_Italics;
-            }
-            else if(TokenMatch(symbol, "|"))
-            {
-                text_style_flags ^= TextStyleFlag_Underline;
-            }
-            else if(TokenMatch(symbol, "`"))
-            {
-                text_style_flags ^= TextStyleFlag_Monospace;
-            }
-            else
-            {
-                PushParseError(context, tokenizer, "Unexpected symbol '%.*s'", symbol.string_length,
-                               symbol.string);
-            }
-        }
-        else if(RequireTokenType(tokenizer, Token_DoubleNewline, &text))
-        {
-            PageNode *node = ParseContextAllocateNode(context);
-            node->type = PageNodeType_ParagraphBreak;
-            node->string = 0;
-            node->string_length = 0;
-            node->text_style_flags = text_style_flags;
-            *node_store_target = node;
-            node_store_target = &(*node_store_target)->next;
-        }
-        
-        token = PeekToken(tokenizer);
-        
-        if(context->error_stack_size > 0)
-        {
-            break;
+                HTMLMinifierWrite(minifier, buffer, string + i, run_end - i);
+                i = run_end;
+            }break;
         }
     }
-    
-    return result;
 }
 
-typedef struct FileProcessData FileProcessData;
-struct FileProcessData
+static void
+OutputBufferAppendStringN(OutputBuffer *buffer, char *string, u64 length)
+{
+    if(buffer->minifier)
+    {
+        MinifyHTML(buffer->minifier, buffer, string, length);
+    }
+    else
+    {
+        OutputBufferWriteN(buffer, string, length);
+    }
+}
+
+static void
+OutputBufferAppendString(OutputBuffer *buffer, char *string)
+{
+    // NOTE(rjf): Null strings come out the way printf's %s has always printed them.
+    if(!string)
+    {
+        string = "(null)";
+    }
+    OutputBufferAppendStringN(buffer, string, CalculateCStringLength(string));
+}
+
+static void
+OutputBufferAppendChar(OutputBuffer *buffer, char c)
+{
+    if(buffer->minifier)
+    {
+        MinifyHTML(buffer->minifier, buffer, &c, 1);
+    }
+    else
+    {
+        OutputBufferReserve(buffer, 1);
+        buffer->data[buffer->size++] = c;
+    }
+}
+
+static void
+OutputBufferAppendInt(OutputBuffer *buffer, int value)
+{
+    char digits[16];
+    int digit_count = 0;
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    do
+    {
+        digits[digit_count++] = '0' + (char)(magnitude % 10);
+        magnitude /= 10;
+    }
+    while(magnitude);
+    
+    char text[16];
+    int text_length = 0;
+    if(value < 0)
+    {
+        text[text_length++] = '-';
+    }
+    while(digit_count > 0)
+    {
+        text[text_length++] = digits[--digit_count];
+    }
+    OutputBufferAppendStringN(buffer, text, text_length);
+}
+
+static void
+OutputBufferAppendHTMLEscapedN(OutputBuffer *buffer, char *string, u64 length)
+{
+    u64 run_start = 0;
+    for(u64 i = 0; i < length; ++i)
+    {
+        char *escape = 0;
+        switch(string[i])
+        {
+            case '<': { escape = "&lt;"; break; }
+            case '>': { escape = "&gt;"; break; }
+            case '&': { escape = "&amp;"; break; }
+            default: break;
+        }
+        if(escape)
+        {
+            OutputBufferAppendStringN(buffer, string + run_start, i - run_start);
+            OutputBufferAppendString(buffer, escape);
+            run_start = i+1;
+        }
+    }
+    OutputBufferAppendStringN(buffer, string + run_start, length - run_start);
+}
+
+typedef u32 OutputFlags;
+#define OutputFlag_HTML      (1<<0)
+#define OutputFlag_Markdown  (1<<1)
+#define OutputFlag_BBCode    (1<<2)
+#define OutputFlag_Gzip      (1<<3)
+#define OutputFlag_Minify    (1<<4)
+
+typedef enum InputType
+{
+    InputType_RXW,
+    InputType_HTML,
+}
+InputType;
+
+typedef enum PageNodeType
+{
+    PageNodeType_Invalid,
+    PageNodeType_PageTitle,
+    PageNodeType_Title,
+    PageNodeType_SubTitle,
+    PageNodeType_Description,
+    PageNodeType_Text,
+    PageNodeType_ParagraphBreak,
+    PageNodeType_UnorderedList,
+    PageNodeType_OrderedList,
+    PageNodeType_Code,
+    PageNodeType_YouTube,
+    PageNodeType_Image,
+    PageNodeType_ThumbnailImage,
+    PageNodeType_Link,
+    PageNodeType_FeatureButton,
+    PageNodeType_Lister,
+    PageNodeType_Date,
+}
+PageNodeType ;
+
+typedef enum CodeLanguageType
+{
+    CodeLanguage_None,
+    CodeLanguage_C,
+}
+CodeLanguageType;
+
+typedef enum OrderedListStyle
+{
+    OrderedListStyle_Numeric,
+    OrderedListStyle_Alphabetic,
+    OrderedListStyle_RomanNumeral,
+}
+OrderedListStyle;
+
+typedef u32 TextStyleFlags;
+#define TextStyleFlag_Bold       (1<<0)
+#define TextStyleFlag_Italics    (1<<1)
+#define TextStyleFlag_Underline  (1<<2)
+#define TextStyleFlag_Monospace  (1<<3)
+
+// NOTE(rjf): A page is stored as parallel arrays indexed by PageNodeID, in document order.
+// Types and text style flags are packed into byte arrays of their own, so that scanning a
+// page for titles, dates, listers, or where a paragraph ends only touches a byte per node.
+// Fields that only a few node types use live in a separate extras array; nodes without any
+// point at extras[0], which is always zero. A list's items are stored right after the list,
+// so moving from a node to its next sibling skips over the items.
+
+typedef u32 PageNodeID;
+
+// NOTE(rjf): An index into the string table; see String Interning.
+typedef u32 StringHandle;
+
+typedef struct PageNodeString PageNodeString;
+struct PageNodeString
+{
+    char *string;
+    int length;
+};
+
+typedef union PageNodeExtra PageNodeExtra;
+union PageNodeExtra
+{
+    struct
+    {
+        OrderedListStyle order_style;
+        u32 item_count;
+    }
+    list;
+    
+    struct
+    {
+        CodeLanguageType language;
+    }
+    code;
+    
+    struct
+    {
+        StringHandle url;
+    }
+    link;
+    
+    struct
+    {
+        StringHandle image_path;
+        StringHandle link;
+    }
+    feature_button;
+    
+    struct
+    {
+        int year;
+        int month;
+        int day;
+    }
+    date;
+    
+    struct
+    {
+        StringHandle prefix;
+        int page_size;
+    }
+    lister;
+};
+
+typedef struct PageNodes PageNodes;
+struct PageNodes
+{
+    u32 count;
+    u8 *types;
+    u8 *text_style_flags;
+    PageNodeString *strings;
+    u32 *extra_indices;
+    u32 extra_count;
+    PageNodeExtra *extras;
+};
+
+static PageNodeExtra *
+PageNodeGetExtra(PageNodes *nodes, PageNodeID id)
+{
+    return nodes->extras + nodes->extra_indices[id];
+}
+
+static PageNodeID
+PageNodeNextSibling(PageNodes *nodes, PageNodeID id)
+{
+    PageNodeID next = id+1;
+    if(nodes->types[id] == PageNodeType_UnorderedList || nodes->types[id] == PageNodeType_OrderedList)
+    {
+        next += PageNodeGetExtra(nodes, id)->list.item_count;
+    }
+    return next;
+}
+
+typedef enum TokenType
+{
+    Token_None,
+    Token_Text,
+    Token_DoubleNewline,
+    Token_Symbol,
+    Token_Tag,
+    Token_StringConstant,
+}
+TokenType;
+
+typedef struct Token Token;
+struct Token
+{
+    TokenType type;
+    char *string;
+    int string_length;
+    int lines_traversed;
+};
+
+//~ NOTE(rjf): Gzip
+//
+// A deflate compressor for the precompressed .gz siblings that --gzip writes next to pages
+// and assets. Compression happens once per changed file at build time, so it goes for size
+// over speed: LZ77 over the whole input with long hash chains and lazy matching, then a
+// dynamic Huffman code per block, or the bytes stored as they are when that is smaller.
+
+#define DEFLATE_WINDOW_SIZE       32768
+#define DEFLATE_MIN_MATCH         3
+#define DEFLATE_MAX_MATCH         258
+#define DEFLATE_HASH_SIZE         (1<<15)
+#define DEFLATE_MAX_CHAIN         1024
+#define DEFLATE_BLOCK_SYMBOLS     (1<<16)
+#define DEFLATE_LITERAL_CODES     286
+#define DEFLATE_DISTANCE_CODES    30
+#define DEFLATE_CODE_LENGTH_CODES 19
+
+static u16 deflate_length_base[29] =
+{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+
+static u8 deflate_length_extra_bits[29] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+
+static u16 deflate_distance_base[30] =
+{
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+
+static u8 deflate_distance_extra_bits[30] =
+{
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+static u8 deflate_code_length_order[DEFLATE_CODE_LENGTH_CODES] =
+{
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+static int
+HighestBit(u32 value)
+{
+    int bit = 0;
+    while(value >>= 1)
+    {
+        ++bit;
+    }
+    return bit;
+}
+
+// NOTE(rjf): Length codes are 257..285 and distance codes 0..29, arranged so that both can
+// be computed from the value's top bits.
+static int
+DeflateLengthCode(int length)
+{
+    int code = 0;
+    int value = length - 3;
+    if(length == DEFLATE_MAX_MATCH)
+    {
+        code = 285;
+    }
+    else if(value < 8)
+    {
+        code = 257 + value;
+    }
+    else
+    {
+        int bit = HighestBit(value);
+        code = 257 + 4*(bit-1) + ((value >> (bit-2)) & 3);
+    }
+    return code;
+}
+
+static int
+DeflateDistanceCode(int distance)
+{
+    int code = distance - 1;
+    if(distance > 4)
+    {
+        int bit = HighestBit(distance - 1);
+        code = 2*bit + (((distance - 1) >> (bit-1)) & 1);
+    }
+    return code;
+}
+
+typedef struct BitWriter BitWriter;
+struct BitWriter
+{
+    OutputBuffer *buffer;
+    u64 bits;
+    int bit_count;
+};
+
+static void
+WriteBits(BitWriter *writer, u32 value, int bit_count)
+{
+    writer->bits |= (u64)value << writer->bit_count;
+    writer->bit_count += bit_count;
+    while(writer->bit_count >= 8)
+    {
+        OutputBufferAppendChar(writer->buffer, (char)(writer->bits & 0xff));
+        writer->bits >>= 8;
+        writer->bit_count -= 8;
+    }
+}
+
+static void
+FlushBits(BitWriter *writer)
+{
+    if(writer->bit_count > 0)
+    {
+        WriteBits(writer, 0, 8 - writer->bit_count);
+    }
+}
+
+typedef struct HuffmanCode HuffmanCode;
+struct HuffmanCode
+{
+    u8 lengths[DEFLATE_LITERAL_CODES];
+    u16 codes[DEFLATE_LITERAL_CODES];
+};
+
+// NOTE(rjf): Builds code lengths from symbol frequencies, no longer than max_length. When the
+// tree comes out too deep, the frequencies are flattened and it is built again, which only
+// ever happens for very skewed blocks. At least two symbols always get a code, since some
+// decoders reject a code with a single symbol.
+static void
+BuildHuffmanLengths(u32 *frequencies, int symbol_count, int max_length, u8 *lengths_out)
+{
+    u32 weights[DEFLATE_LITERAL_CODES];
+    MemoryCopy(weights, frequencies, sizeof(u32)*symbol_count);
+    int used_count = 0;
+    for(int i = 0; i < symbol_count; ++i)
+    {
+        used_count += !!weights[i];
+    }
+    for(int i = 0; used_count < 2 && i < symbol_count; ++i)
+    {
+        if(!weights[i])
+        {
+            weights[i] = 1;
+            ++used_count;
+        }
+    }
+
+    for(;;)
+    {
+        // NOTE(rjf): Leaves sorted by weight, then the classic two-queue merge: internal nodes
+        // are created in nondecreasing order of weight, so the two lightest nodes are always
+        // at the front of one queue or the other.
+        int leaves[DEFLATE_LITERAL_CODES];
+        int leaf_count = 0;
+        for(int i = 0; i < symbol_count; ++i)
+        {
+            if(weights[i])
+            {
+                int j = leaf_count++;
+                for(; j > 0 && weights[leaves[j-1]] > weights[i]; --j)
+                {
+                    leaves[j] = leaves[j-1];
+                }
+                leaves[j] = i;
+            }
+        }
+
+        u64 node_weights[2*DEFLATE_LITERAL_CODES];
+        int parents[2*DEFLATE_LITERAL_CODES];
+        for(int i = 0; i < leaf_count; ++i)
+        {
+            node_weights[i] = weights[leaves[i]];
+        }
+        int node_count = leaf_count;
+        int next_leaf = 0;
+        int next_internal = leaf_count;
+        for(int merge = 0; merge < leaf_count-1; ++merge)
+        {
+            int children[2];
+            for(int child = 0; child < 2; ++child)
+            {
+                if(next_leaf < leaf_count &&
+                   (next_internal >= node_count || node_weights[next_leaf] <= node_weights[next_internal]))
+                {
+                    children[child] = next_leaf++;
+                }
+                else
+                {
+                    children[child] = next_internal++;
+                }
+            }
+            node_weights[node_count] = node_weights[children[0]] + node_weights[children[1]];
+            parents[children[0]] = node_count;
+            parents[children[1]] = node_count;
+            ++node_count;
+        }
+
+        // NOTE(rjf): Parents always come after their children, so depths fill in backwards.
+        int depths[2*DEFLATE_LITERAL_CODES];
+        depths[node_count-1] = 0;
+        int deepest = 0;
+        for(int i = node_count-2; i >= 0; --i)
+        {
+            depths[i] = depths[parents[i]] + 1;
+            if(i < leaf_count && deepest < depths[i])
+            {
+                deepest = depths[i];
+            }
+        }
+
+        if(deepest <= max_length)
+        {
+            MemorySet(lengths_out, 0, symbol_count);
+            for(int i = 0; i < leaf_count; ++i)
+            {
+                lengths_out[leaves[i]] = (u8)depths[i];
+            }
+            break;
+        }
+
+        for(int i = 0; i < symbol_count; ++i)
+        {
+            if(weights[i])
+            {
+                weights[i] = (weights[i] >> 1) | 1;
+            }
+        }
+    }
+}
+
+// NOTE(rjf): Canonical codes, bit-reversed, because deflate packs Huffman codes starting from
+// their most significant bit while everything else goes in least significant bit first.
+static void
+BuildHuffmanCodes(HuffmanCode *code, int symbol_count)
+{
+    int length_counts[16] = {0};
+    for(int i = 0; i < symbol_count; ++i)
+    {
+        length_counts[code->lengths[i]] += 1;
+    }
+    length_counts[0] = 0;
+
+    int next_codes[16] = {0};
+    for(int length = 1, next_code = 0; length < 16; ++length)
+    {
+        next_code = (next_code + length_counts[length-1]) << 1;
+        next_codes[length] = next_code;
+    }
+
+    for(int i = 0; i < symbol_count; ++i)
+    {
+        int length = code->lengths[i];
+        code->codes[i] = 0;
+        if(length)
+        {
+            int value = next_codes[length]++;
+            int reversed = 0;
+            for(int bit = 0; bit < length; ++bit)
+            {
+                reversed = (reversed << 1) | ((value >> bit) & 1);
+            }
+            code->codes[i] = (u16)reversed;
+        }
+    }
+}
+
+typedef struct DeflateSymbol DeflateSymbol;
+struct DeflateSymbol
+{
+    // NOTE(rjf): A literal byte when distance is 0, a match length otherwise.
+    u16 value;
+    u16 distance;
+};
+
+#define DEFLATE_STORED_BLOCK_MAX 65535
+
+// NOTE(rjf): Stored blocks (type 0) hold the bytes as they are, at most 65535 of them each,
+// after a header that is padded out to a byte boundary.
+static u64
+StoredBlocksBitCount(BitWriter *writer, u64 size)
+{
+    u64 block_count = size ? (size + DEFLATE_STORED_BLOCK_MAX-1) / DEFLATE_STORED_BLOCK_MAX : 1;
+    u64 first_padding = (8 - (writer->bit_count + 3) % 8) % 8;
+    return block_count*(3 + 32) + first_padding + (block_count-1)*5 + 8*size;
+}
+
+static void
+WriteStoredBlocks(BitWriter *writer, u8 *data, u64 size, int final)
+{
+    u64 block_count = size ? (size + DEFLATE_STORED_BLOCK_MAX-1) / DEFLATE_STORED_BLOCK_MAX : 1;
+    for(u64 i = 0; i < block_count; ++i)
+    {
+        u64 offset = i*DEFLATE_STORED_BLOCK_MAX;
+        u32 block_size = (u32)(size - offset < DEFLATE_STORED_BLOCK_MAX ? size - offset : DEFLATE_STORED_BLOCK_MAX);
+        WriteBits(writer, final && i+1 == block_count, 1);
+        WriteBits(writer, 0, 2);
+        FlushBits(writer);
+        WriteBits(writer, block_size, 16);
+        WriteBits(writer, block_size ^ 0xffff, 16);
+        OutputBufferWriteN(writer->buffer, (char *)data + offset, block_size);
+    }
+}
+
+// NOTE(rjf): data and size are the input bytes the symbols encode. When a dynamic Huffman
+// block would come out bigger than storing those as they are (incompressible input), they
+// are stored instead.
+static void
+WriteDeflateBlock(BitWriter *writer, DeflateSymbol *symbols, int symbol_count, u8 *data, u64 size, int final)
+{
+    u32 literal_frequencies[DEFLATE_LITERAL_CODES] = {0};
+    u32 distance_frequencies[DEFLATE_DISTANCE_CODES] = {0};
+    for(int i = 0; i < symbol_count; ++i)
+    {
+        if(symbols[i].distance)
+        {
+            literal_frequencies[DeflateLengthCode(symbols[i].value)] += 1;
+            distance_frequencies[DeflateDistanceCode(symbols[i].distance)] += 1;
+        }
+        else
+        {
+            literal_frequencies[symbols[i].value] += 1;
+        }
+    }
+    literal_frequencies[256] = 1;
+
+    HuffmanCode literal_code = {0};
+    HuffmanCode distance_code = {0};
+    BuildHuffmanLengths(literal_frequencies, DEFLATE_LITERAL_CODES, 15, literal_code.lengths);
+    BuildHuffmanLengths(distance_frequencies, DEFLATE_DISTANCE_CODES, 15, distance_code.lengths);
+    BuildHuffmanCodes(&literal_code, DEFLATE_LITERAL_CODES);
+    BuildHuffmanCodes(&distance_code, DEFLATE_DISTANCE_CODES);
+
+    int literal_count = DEFLATE_LITERAL_CODES;
+    while(literal_count > 257 && !literal_code.lengths[literal_count-1])
+    {
+        --literal_count;
+    }
+    int distance_count = DEFLATE_DISTANCE_CODES;
+    while(distance_count > 1 && !distance_code.lengths[distance_count-1])
+    {
+        --distance_count;
+    }
+
+    // NOTE(rjf): Both tables' code lengths go out as one run-length encoded sequence, which is
+    // itself Huffman coded. Each entry is a code length symbol, then its extra bits.
+    u8 lengths[DEFLATE_LITERAL_CODES + DEFLATE_DISTANCE_CODES];
+    int length_count = 0;
+    for(int i = 0; i < literal_count; ++i)
+    {
+        lengths[length_count++] = literal_code.lengths[i];
+    }
+    for(int i = 0; i < distance_count; ++i)
+    {
+        lengths[length_count++] = distance_code.lengths[i];
+    }
+
+    u8 runs[2*(DEFLATE_LITERAL_CODES + DEFLATE_DISTANCE_CODES)];
+    int run_count = 0;
+    u32 run_frequencies[DEFLATE_CODE_LENGTH_CODES] = {0};
+    for(int i = 0; i < length_count;)
+    {
+        int length = lengths[i];
+        int repeat = 1;
+        while(i + repeat < length_count && lengths[i + repeat] == length)
+        {
+            ++repeat;
+        }
+
+        if(length == 0 && repeat >= 3)
+        {
+            repeat = repeat > 138 ? 138 : repeat;
+            runs[run_count++] = repeat >= 11 ? 18 : 17;
+            runs[run_count++] = (u8)(repeat >= 11 ? repeat - 11 : repeat - 3);
+        }
+        else if(length != 0 && repeat >= 4)
+        {
+            repeat = repeat > 7 ? 7 : repeat;
+            runs[run_count++] = (u8)length;
+            runs[run_count++] = 0;
+            runs[run_count++] = 16;
+            runs[run_count++] = (u8)(repeat - 4);
+        }
+        else
+        {
+            repeat = 1;
+            runs[run_count++] = (u8)length;
+            runs[run_count++] = 0;
+        }
+        i += repeat;
+    }
+    for(int i = 0; i < run_count; i += 2)
+    {
+        run_frequencies[runs[i]] += 1;
+    }
+
+    HuffmanCode run_code = {0};
+    BuildHuffmanLengths(run_frequencies, DEFLATE_CODE_LENGTH_CODES, 7, run_code.lengths);
+    BuildHuffmanCodes(&run_code, DEFLATE_CODE_LENGTH_CODES);
+    int run_code_count = DEFLATE_CODE_LENGTH_CODES;
+    while(run_code_count > 4 && !run_code.lengths[deflate_code_length_order[run_code_count-1]])
+    {
+        --run_code_count;
+    }
+
+    u64 dynamic_bit_count = 3 + 5 + 5 + 4 + 3*run_code_count;
+    for(int i = 0; i < run_count; i += 2)
+    {
+        int symbol = runs[i];
+        dynamic_bit_count += run_code.lengths[symbol];
+        dynamic_bit_count += (symbol == 16 ? 2 : symbol == 17 ? 3 : symbol == 18 ? 7 : 0);
+    }
+    for(int i = 0; i < DEFLATE_LITERAL_CODES; ++i)
+    {
+        int extra_bits = i > 256 ? deflate_length_extra_bits[i-257] : 0;
+        dynamic_bit_count += (u64)literal_frequencies[i] * (literal_code.lengths[i] + extra_bits);
+    }
+    for(int i = 0; i < DEFLATE_DISTANCE_CODES; ++i)
+    {
+        dynamic_bit_count += (u64)distance_frequencies[i] * (distance_code.lengths[i] + deflate_distance_extra_bits[i]);
+    }
+    if(StoredBlocksBitCount(writer, size) < dynamic_bit_count)
+    {
+        WriteStoredBlocks(writer, data, size, final);
+    }
+    else
+    {
+        WriteBits(writer, final, 1);
+        WriteBits(writer, 2, 2);
+        WriteBits(writer, literal_count - 257, 5);
+        WriteBits(writer, distance_count - 1, 5);
+        WriteBits(writer, run_code_count - 4, 4);
+        for(int i = 0; i < run_code_count; ++i)
+        {
+            WriteBits(writer, run_code.lengths[deflate_code_length_order[i]], 3);
+        }
+        for(int i = 0; i < run_count; i += 2)
+        {
+            int symbol = runs[i];
+            WriteBits(writer, run_code.codes[symbol], run_code.lengths[symbol]);
+            if(symbol >= 16)
+            {
+                WriteBits(writer, runs[i+1], symbol == 16 ? 2 : symbol == 17 ? 3 : 7);
+            }
+        }
+
+        for(int i = 0; i < symbol_count; ++i)
+        {
+            DeflateSymbol *symbol = symbols + i;
+            if(symbol->distance)
+            {
+                int length_code = DeflateLengthCode(symbol->value);
+                WriteBits(writer, literal_code.codes[length_code], literal_code.lengths[length_code]);
+                WriteBits(writer, symbol->value - deflate_length_base[length_code-257],
+                          deflate_length_extra_bits[length_code-257]);
+                int distance_symbol = DeflateDistanceCode(symbol->distance);
+                WriteBits(writer, distance_code.codes[distance_symbol], distance_code.lengths[distance_symbol]);
+                WriteBits(writer, symbol->distance - deflate_distance_base[distance_symbol],
+                          deflate_distance_extra_bits[distance_symbol]);
+            }
+            else
+            {
+                WriteBits(writer, literal_code.codes[symbol->value], literal_code.lengths[symbol->value]);
+            }
+        }
+        WriteBits(writer, literal_code.codes[256], literal_code.lengths[256]);
+    }
+}
+
+static u32
+DeflateHash(u8 *bytes)
+{
+    u32 value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+    return (value * 2654435761u) >> (32 - 15);
+}
+
+static int
+DeflateFindMatch(u8 *data, u64 size, u64 position, i32 *head, i32 *previous, int *distance_out)
+{
+    int best_length = 0;
+    int best_distance = 0;
+    if(position + DEFLATE_MIN_MATCH <= size)
+    {
+        u64 max_length = size - position;
+        if(max_length > DEFLATE_MAX_MATCH)
+        {
+            max_length = DEFLATE_MAX_MATCH;
+        }
+        i64 candidate = head[DeflateHash(data + position)];
+        for(int chain = 0; chain < DEFLATE_MAX_CHAIN && candidate >= 0; ++chain)
+        {
+            u64 distance = position - (u64)candidate;
+            if(distance > DEFLATE_WINDOW_SIZE)
+            {
+                break;
+            }
+            if(data[candidate + best_length] == data[position + best_length])
+            {
+                int length = 0;
+                while(length < (int)max_length && data[candidate + length] == data[position + length])
+                {
+                    ++length;
+                }
+                if(length > best_length)
+                {
+                    best_length = length;
+                    best_distance = (int)distance;
+                    if(length == (int)max_length)
+                    {
+                        break;
+                    }
+                }
+            }
+            candidate = previous[candidate % DEFLATE_WINDOW_SIZE];
+        }
+    }
+    *distance_out = best_distance;
+    return best_length >= DEFLATE_MIN_MATCH ? best_length : 0;
+}
+
+static void
+DeflateInsert(u8 *data, u64 size, u64 position, i32 *head, i32 *previous)
+{
+    if(position + DEFLATE_MIN_MATCH <= size)
+    {
+        u32 hash = DeflateHash(data + position);
+        previous[position % DEFLATE_WINDOW_SIZE] = head[hash];
+        head[hash] = (i32)position;
+    }
+}
+
+static void
+Deflate(u8 *data, u64 size, OutputBuffer *output)
+{
+    i32 *head = malloc(sizeof(i32)*DEFLATE_HASH_SIZE);
+    i32 *previous = malloc(sizeof(i32)*DEFLATE_WINDOW_SIZE);
+    DeflateSymbol *symbols = malloc(sizeof(DeflateSymbol)*DEFLATE_BLOCK_SYMBOLS);
+    for(int i = 0; i < DEFLATE_HASH_SIZE; ++i)
+    {
+        head[i] = -1;
+    }
+
+    BitWriter writer = {0};
+    writer.buffer = output;
+    int symbol_count = 0;
+    u64 block_start = 0;
+    int next_distance = 0;
+    int next_length = -1;
+    for(u64 position = 0; position < size;)
+    {
+        // NOTE(rjf): Lazy matching: a match is only taken if the one starting at the next byte
+        // isn't longer. That next match is kept for the following step.
+        int distance = 0;
+        int length = next_length;
+        if(length < 0)
+        {
+            length = DeflateFindMatch(data, size, position, head, previous, &distance);
+        }
+        else
+        {
+            distance = next_distance;
+        }
+        DeflateInsert(data, size, position, head, previous);
+        next_length = -1;
+
+        if(length && length < DEFLATE_MAX_MATCH && position + 1 < size)
+        {
+            next_length = DeflateFindMatch(data, size, position + 1, head, previous, &next_distance);
+            if(next_length > length)
+            {
+                length = 0;
+            }
+            else
+            {
+                next_length = -1;
+            }
+        }
+
+        if(length)
+        {
+            symbols[symbol_count].value = (u16)length;
+            symbols[symbol_count].distance = (u16)distance;
+            for(int i = 1; i < length; ++i)
+            {
+                DeflateInsert(data, size, position + i, head, previous);
+            }
+            position += length;
+        }
+        else
+        {
+            symbols[symbol_count].value = data[position];
+            symbols[symbol_count].distance = 0;
+            position += 1;
+        }
+
+        if(++symbol_count == DEFLATE_BLOCK_SYMBOLS)
+        {
+            WriteDeflateBlock(&writer, symbols, symbol_count, data + block_start, position - block_start, 0);
+            symbol_count = 0;
+            block_start = position;
+        }
+    }
+    WriteDeflateBlock(&writer, symbols, symbol_count, data + block_start, size - block_start, 1);
+    FlushBits(&writer);
+
+    free(symbols);
+    free(previous);
+    free(head);
+}
+
+// NOTE(rjf): The CRC-32 (gzip's) of each byte value, with the reflected polynomial 0xedb88320.
+static u32 crc32_table[256] =
+{
+    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
+    0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988, 0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91,
+    0x1db71064, 0x6ab020f2, 0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9, 0xfa0f3d63, 0x8d080df5,
+    0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172, 0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b,
+    0x35b5a8fa, 0x42b2986c, 0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423, 0xcfba9599, 0xb8bda50f,
+    0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924, 0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d,
+    0x76dc4190, 0x01db7106, 0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d, 0x91646c97, 0xe6635c01,
+    0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e, 0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457,
+    0x65b0d9c6, 0x12b7e950, 0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7, 0xa4d1c46d, 0xd3d6f4fb,
+    0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0, 0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9,
+    0x5005713c, 0x270241aa, 0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81, 0xb7bd5c3b, 0xc0ba6cad,
+    0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a, 0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683,
+    0xe3630b12, 0x94643b84, 0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb, 0x196c3671, 0x6e6b06e7,
+    0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc, 0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5,
+    0xd6d6a3e8, 0xa1d1937e, 0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55, 0x316e8eef, 0x4669be79,
+    0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236, 0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f,
+    0xc5ba3bbe, 0xb2bd0b28, 0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f, 0x72076785, 0x05005713,
+    0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38, 0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21,
+    0x86d3d2d4, 0xf1d4e242, 0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69, 0x616bffd3, 0x166ccf45,
+    0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2, 0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db,
+    0xaed16a4a, 0xd9d65adc, 0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693, 0x54de5729, 0x23d967bf,
+    0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d,
+};
+
+static u32
+CRC32(u8 *data, u64 size)
+{
+    u32 crc = 0xffffffffu;
+    for(u64 i = 0; i < size; ++i)
+    {
+        crc = crc32_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+static void
+OutputBufferAppendU32LE(OutputBuffer *buffer, u32 value)
+{
+    for(int i = 0; i < 4; ++i)
+    {
+        OutputBufferAppendChar(buffer, (char)((value >> (8*i)) & 0xff));
+    }
+}
+
+// NOTE(rjf): A gzip member with no name or timestamp, so the same input always compresses to
+// the same bytes.
+static void
+GzipCompress(u8 *data, u64 size, OutputBuffer *output)
+{
+    static char header[10] = { 0x1f, (char)0x8b, 8, 0, 0, 0, 0, 0, 2, (char)0xff };
+    OutputBufferAppendStringN(output, header, sizeof(header));
+    Deflate(data, size, output);
+    OutputBufferAppendU32LE(output, CRC32(data, size));
+    OutputBufferAppendU32LE(output, (u32)size);
+}
+
+// NOTE(rjf): Writes "<path>.gz", through a temporary file like every other output. A .gz that
+// would be no smaller than the file isn't worth serving, so it is skipped, and an old one is
+// removed. Returns whether a .gz was written.
+static int
+WriteGzipSibling(char *path, u8 *data, u64 size)
+{
+    int written = 0;
+    int failed = 0;
+    char gzip_path[1024] = {0};
+    char temporary_path[1024] = {0};
+    snprintf(gzip_path, sizeof(gzip_path), "%s.gz", path);
+    snprintf(temporary_path, sizeof(temporary_path), "%s.gz.tmp", path);
+    
+    OutputBuffer compressed = {0};
+    GzipCompress(data, size, &compressed);
+    if(compressed.size >= size)
+    {
+        failed = (remove(gzip_path) != 0 && GetFileInfo(gzip_path).exists);
+    }
+    else
+    {
+        FILE *file = fopen(temporary_path, "wb");
+        if(file)
+        {
+            written = (fwrite(compressed.data, 1, compressed.size, file) == compressed.size);
+            written = (fclose(file) == 0) && written;
+            written = written && RenameFileReplacing(temporary_path, gzip_path);
+            if(!written)
+            {
+                remove(temporary_path);
+            }
+        }
+        failed = !written;
+    }
+    free(compressed.data);
+    
+    if(failed)
+    {
+        fprintf(stderr, "ERROR: Could not write \"%s\".\n", gzip_path);
+    }
+    return written;
+}
+
+// NOTE(rjf): A .gz is always written after the file it compresses, so one that is older than
+// that file is stale.
+static int
+GzipSiblingIsCurrent(char *path)
+{
+    char gzip_path[1024] = {0};
+    snprintf(gzip_path, sizeof(gzip_path), "%s.gz", path);
+    FileInfo info = GetFileInfo(path);
+    FileInfo gzip_info = GetFileInfo(gzip_path);
+    return (gzip_info.exists && gzip_info.modified_time >= info.modified_time);
+}
+
+//~ NOTE(rjf): Memory Arenas
+//
+// Each arena is a chain of malloc'd blocks. Block sizes double from ARENA_BLOCK_SIZE_MIN up
+// to ARENA_BLOCK_SIZE_MAX, so a worker that parses a big site makes a handful of allocations
+// instead of one every few kilobytes, and the space left at the end of a block when an
+// allocation doesn't fit is small next to everything before it.
+//
+// An arena is only ever freed whole, with ArenaRelease. There are deliberately no temp
+// save/restore regions. Per-page scratch (the page being built) lives in ParseContext's
+// scratch_nodes instead, which are reused from page to page and copied into the arena at
+// their final size, so nothing per-page is left behind to roll back.
+//
+// The block_allocation_count that --stats reports counts these parse arenas' block mallocs
+// only, not every malloc the process makes.
+
+#define ARENA_BLOCK_SIZE_MIN (64*1024)
+#define ARENA_BLOCK_SIZE_MAX (64*1024*1024)
+#define ARENA_ALIGNMENT 8
+
+typedef struct ArenaBlock ArenaBlock;
+struct ArenaBlock
+{
+    ArenaBlock *prev;
+    u64 size;
+    u64 position;
+    char *memory;
+};
+
+typedef struct Arena Arena;
+struct Arena
+{
+    ArenaBlock *current;
+    u64 next_block_size;
+    
+    // NOTE(rjf): Stats
+    int block_allocation_count;
+    u64 reserved_size;
+};
+
+static void *
+ArenaPush(Arena *arena, u64 size)
+{
+    size = (size + ARENA_ALIGNMENT-1) & ~(u64)(ARENA_ALIGNMENT-1);
+    
+    ArenaBlock *block = arena->current;
+    if(!block || block->position + size > block->size)
+    {
+        u64 block_size = arena->next_block_size ? arena->next_block_size : ARENA_BLOCK_SIZE_MIN;
+        if(block_size < ARENA_BLOCK_SIZE_MAX)
+        {
+            arena->next_block_size = block_size*2;
+        }
+        if(block_size < size)
+        {
+            block_size = size;
+        }
+        block = malloc(sizeof(ArenaBlock) + block_size);
+        block->size = block_size;
+        block->memory = (char *)(block+1);
+        arena->block_allocation_count += 1;
+        arena->reserved_size += block_size;
+        
+        block->position = 0;
+        block->prev = arena->current;
+        arena->current = block;
+    }
+    
+    void *memory = block->memory + block->position;
+    block->position += size;
+    return memory;
+}
+
+static void
+ArenaRelease(Arena *arena)
+{
+    ArenaBlock *next = 0;
+    for(ArenaBlock *block = arena->current; block; block = next)
+    {
+        next = block->prev;
+        free(block);
+    }
+    MemorySet(arena, 0, sizeof(*arena));
+}
+
+static u64
+ArenaUsedSize(Arena *arena)
+{
+    u64 used_size = 0;
+    for(ArenaBlock *block = arena->current; block; block = block->prev)
+    {
+        used_size += block->position;
+    }
+    return used_size;
+}
+
+//~ NOTE(rjf): String Interning
+//
+// Strings that repeat across pages (link URLs, image paths, lister prefixes, page titles) are
+// stored once in a table shared by every worker, and referred to by a 32-bit StringHandle.
+// Two handles are equal exactly when their strings are, so comparing them is an integer
+// compare. Handle 0 is always the empty string.
+//
+// Interning takes a lock. Reading a handle back doesn't: entries live in fixed-size chunks
+// that never move once allocated, and a handle only reaches another thread through the job
+// system, which finishes every job before the next phase starts.
+
+#define STRING_TABLE_CHUNK_SHIFT 12
+#define STRING_TABLE_CHUNK_SIZE (1<<STRING_TABLE_CHUNK_SHIFT)
+#define STRING_TABLE_CHUNK_COUNT_MAX 4096
+
+typedef struct InternedString InternedString;
+struct InternedString
+{
+    char *string;
+    int length;
+    u32 hash;
+};
+
+typedef struct StringTable StringTable;
+struct StringTable
+{
+    Mutex mutex;
+    Arena arena;
+    u32 count;
+    InternedString *chunks[STRING_TABLE_CHUNK_COUNT_MAX];
+    
+    // NOTE(rjf): Open-addressed, so slot_count is always a power of two.
+    u32 slot_count;
+    StringHandle *slots;
+    
+    // NOTE(rjf): Stats
+    u64 intern_count;
+    u64 interned_bytes;
+};
+
+static StringTable string_table = { .mutex = MUTEX_INITIALIZER };
+
+static InternedString *
+GetInternedString(StringHandle handle)
+{
+    static InternedString empty_string = { "", 0, 0 };
+    InternedString *result = &empty_string;
+    if(handle)
+    {
+        result = string_table.chunks[handle >> STRING_TABLE_CHUNK_SHIFT] + (handle & (STRING_TABLE_CHUNK_SIZE-1));
+    }
+    return result;
+}
+
+static StringHandle
+InternString(char *string, int length)
+{
+    StringHandle handle = 0;
+    if(length > 0)
+    {
+        StringTable *table = &string_table;
+        u32 hash = (u32)HashBytes(HASH_BEGIN, string, length);
+        
+        MutexLock(&table->mutex);
+        
+        table->intern_count += 1;
+        
+        // NOTE(rjf): Keep the slots at most half full. Entry 0 is reserved for the empty string.
+        if((table->count+1)*2 > table->slot_count)
+        {
+            u32 slot_count = table->slot_count ? table->slot_count*2 : 4096;
+            StringHandle *slots = calloc(slot_count, sizeof(StringHandle));
+            for(u32 i = 1; i < table->count; ++i)
+            {
+                u32 slot = GetInternedString(i)->hash & (slot_count-1);
+                while(slots[slot])
+                {
+                    slot = (slot+1) & (slot_count-1);
+                }
+                slots[slot] = i;
+            }
+            free(table->slots);
+            table->slots = slots;
+            table->slot_count = slot_count;
+            if(!table->count)
+            {
+                table->count = 1;
+            }
+        }
+        
+        u32 slot = hash & (table->slot_count-1);
+        for(;;)
+        {
+            handle = table->slots[slot];
+            if(!handle)
+            {
+                break;
+            }
+            InternedString *entry = GetInternedString(handle);
+            if(entry->hash == hash && entry->length == length &&
+               CStringMatchCaseSensitiveN(entry->string, string, length))
+            {
+                break;
+            }
+            slot = (slot+1) & (table->slot_count-1);
+        }
+        
+        if(!handle)
+        {
+            u32 chunk_index = table->count >> STRING_TABLE_CHUNK_SHIFT;
+            if(chunk_index >= STRING_TABLE_CHUNK_COUNT_MAX)
+            {
+                fprintf(stderr, "FATAL: Too many distinct strings.\n");
+                exit(1);
+            }
+            if(!table->chunks[chunk_index])
+            {
+                table->chunks[chunk_index] = ArenaPush(&table->arena, sizeof(InternedString)*STRING_TABLE_CHUNK_SIZE);
+            }
+            
+            char *copy = ArenaPush(&table->arena, length+1);
+            MemoryCopy(copy, string, length);
+            copy[length] = 0;
+            
+            handle = table->count++;
+            InternedString *entry = GetInternedString(handle);
+            entry->string = copy;
+            entry->length = length;
+            entry->hash = hash;
+            table->slots[slot] = handle;
+            table->interned_bytes += length+1;
+        }
+        
+        MutexUnlock(&table->mutex);
+    }
+    return handle;
+}
+
+static char *
+InternedCString(StringHandle handle)
+{
+    return GetInternedString(handle)->string;
+}
+
+//~ NOTE(rjf): Profiling
+//
+// With --profile, each step of the build is recorded as a zone: which phase it was, which
+// worker ran it, which file it was for, and when it started and ended. Every worker appends
+// to a zone list of its own, so recording doesn't take a lock. Per-file totals and counters go
+// into the file's FileProfile, which only the job handling that file touches. After the build,
+// zones are summed into a table per phase, and written out as Chrome trace-event JSON, which
+// chrome://tracing and Perfetto can open.
+//
+// When profiling is off, ProfileBegin and ProfileEnd don't read the clock.
+
+#define PROFILE_TRACE_PATH "generator_profile.json"
+
+typedef enum ProfilePhase
+{
+    ProfilePhase_Load,
+    ProfilePhase_Tokenize,
+    ProfilePhase_Parse,
+    ProfilePhase_Metadata,
+    ProfilePhase_Sort,
+    ProfilePhase_Emit,
+    ProfilePhase_Write,
+    ProfilePhase_Assets,
+    ProfilePhase_COUNT
+}
+ProfilePhase;
+
+static char *profile_phase_names[ProfilePhase_COUNT] =
+{
+    "load",
+    "tokenize",
+    "parse",
+    "metadata",
+    "sort",
+    "emit",
+    "write",
+    "assets",
+};
+
+typedef struct ProfileZone ProfileZone;
+struct ProfileZone
+{
+    ProfilePhase phase;
+    char *filename;
+    u64 start_time;
+    u64 end_time;
+};
+
+typedef struct ProfileWorker ProfileWorker;
+struct ProfileWorker
+{
+    int zone_count;
+    int zone_capacity;
+    ProfileZone *zones;
+};
+
+typedef struct FileProfile FileProfile;
+struct FileProfile
+{
+    u64 phase_time[ProfilePhase_COUNT];
+    u64 bytes_in;
+    u64 bytes_out;
+    u64 token_count;
+    u64 node_count;
+    u64 arena_bytes;
+};
+
+typedef struct Profiler Profiler;
+struct Profiler
+{
+    int enabled;
+    u64 start_time;
+    int worker_count;
+    ProfileWorker *workers;
+};
+
+static Profiler profiler;
+
+static void
+ProfilerInit(int worker_count)
+{
+    profiler.enabled = 1;
+    profiler.start_time = GetTimeMicroseconds();
+    profiler.worker_count = worker_count;
+    profiler.workers = calloc(worker_count, sizeof(ProfileWorker));
+}
+
+static u64
+ProfileBegin(void)
+{
+    return profiler.enabled ? GetTimeMicroseconds() : 0;
+}
+
+// NOTE(rjf): Returns the zone's duration, in microseconds.
+static u64
+ProfileEnd(ProfilePhase phase, u64 start_time, int worker_index, char *filename, FileProfile *file_profile)
+{
+    u64 duration = 0;
+    if(profiler.enabled)
+    {
+        u64 end_time = GetTimeMicroseconds();
+        duration = end_time - start_time;
+        
+        ProfileWorker *worker = profiler.workers + worker_index;
+        if(worker->zone_count >= worker->zone_capacity)
+        {
+            worker->zone_capacity = worker->zone_capacity ? worker->zone_capacity*2 : 1024;
+            worker->zones = realloc(worker->zones, sizeof(ProfileZone)*worker->zone_capacity);
+        }
+        ProfileZone *zone = worker->zones + worker->zone_count++;
+        zone->phase = phase;
+        zone->filename = filename;
+        zone->start_time = start_time;
+        zone->end_time = end_time;
+        
+        if(file_profile)
+        {
+            file_profile->phase_time[phase] += duration;
+        }
+    }
+    return duration;
+}
+
+//~ NOTE(rjf): Text Scanning
+//
+// Prose is most of what we parse, so finding the end of a text run and counting newlines
+// are done 16 (SSE2) or 32 (AVX2) bytes at a time where we can. Blocks are loaded from
+// aligned addresses, so a load never crosses into a page that the buffer doesn't touch,
+// even though it may read a few bytes before the start or past the null terminator.
+// Define GENERATOR_NO_SIMD to force the scalar paths.
+
+#if !defined(GENERATOR_NO_SIMD)
+#if defined(__AVX2__)
+#define GENERATOR_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GENERATOR_SSE2 1
+#include <emmintrin.h>
+#endif
+#endif
+
+#if GENERATOR_AVX2 || GENERATOR_SSE2
+static int
+CountTrailingZeros32(u32 value)
+{
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return (int)index;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+static int
+CountSetBits32(u32 value)
+{
+#if defined(_MSC_VER)
+    value = value - ((value >> 1) & 0x55555555);
+    value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+    return (int)((((value + (value >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+#else
+    return __builtin_popcount(value);
+#endif
+}
+#else
+static int
+CharIsText(int c)
+{
+    return (!CharIsSymbol(c) && c != '@');
+}
+#endif
+
+// NOTE(rjf): Returns the first character at or after `at` that ends a text token: a symbol,
+// a tag, a newline, the null terminator, and optionally a comma.
+static char *
+FindEndOfTextRun(char *at, int break_text_by_commas)
+{
+    char comma = break_text_by_commas ? ',' : 0;
+    
+#if GENERATOR_AVX2 || GENERATOR_SSE2
+    
+#if GENERATOR_AVX2
+#define TEXT_SCAN_BLOCK_SIZE 32
+#define TextScanVector __m256i
+#define TextScanSplat(c) _mm256_set1_epi8(c)
+#define TextScanLoad(p) _mm256_load_si256((__m256i *)(p))
+#define TextScanEqual(a, b) _mm256_cmpeq_epi8(a, b)
+#define TextScanOr(a, b) _mm256_or_si256(a, b)
+#define TextScanMask(a) (u32)_mm256_movemask_epi8(a)
+#else
+#define TEXT_SCAN_BLOCK_SIZE 16
+#define TextScanVector __m128i
+#define TextScanSplat(c) _mm_set1_epi8(c)
+#define TextScanLoad(p) _mm_load_si128((__m128i *)(p))
+#define TextScanEqual(a, b) _mm_cmpeq_epi8(a, b)
+#define TextScanOr(a, b) _mm_or_si128(a, b)
+#define TextScanMask(a) (u32)_mm_movemask_epi8(a)
+#endif
+    
+    TextScanVector stop_0 = TextScanSplat(0);
+    TextScanVector stop_newline = TextScanSplat('\n');
+    TextScanVector stop_comma = TextScanSplat(comma);
+    TextScanVector stop_tag = TextScanSplat('@');
+    TextScanVector stop_open = TextScanSplat('{');
+    TextScanVector stop_close = TextScanSplat('}');
+    TextScanVector stop_star = TextScanSplat('*');
+    TextScanVector stop_pipe = TextScanSplat('|');
+    TextScanVector stop_tick = TextScanSplat('`');
+    
+    int misalignment = (int)((uintptr_t)at & (TEXT_SCAN_BLOCK_SIZE-1));
+    char *block = at - misalignment;
+    u32 ignore_mask = ~(u32)0 << misalignment;
+    
+    for(;; block += TEXT_SCAN_BLOCK_SIZE, ignore_mask = ~(u32)0)
+    {
+        TextScanVector bytes = TextScanLoad(block);
+        TextScanVector stops = TextScanOr(TextScanOr(TextScanOr(TextScanEqual(bytes, stop_0),
+                                                                TextScanEqual(bytes, stop_newline)),
+                                                     TextScanOr(TextScanEqual(bytes, stop_comma),
+                                                                TextScanEqual(bytes, stop_tag))),
+                                          TextScanOr(TextScanOr(TextScanEqual(bytes, stop_open),
+                                                                TextScanEqual(bytes, stop_close)),
+                                                     TextScanOr(TextScanOr(TextScanEqual(bytes, stop_star),
+                                                                           TextScanEqual(bytes, stop_pipe)),
+                                                                TextScanEqual(bytes, stop_tick))));
+        u32 mask = TextScanMask(stops) & ignore_mask;
+        if(mask)
+        {
+            return block + CountTrailingZeros32(mask);
+        }
+    }
+    
+#undef TEXT_SCAN_BLOCK_SIZE
+#undef TextScanVector
+#undef TextScanSplat
+#undef TextScanLoad
+#undef TextScanEqual
+#undef TextScanOr
+#undef TextScanMask
+    
+#else
+    for(; *at && CharIsText(*at) && *at != '\n' && (!comma || *at != comma); ++at);
+    return at;
+#endif
+}
+
+static int
+CountNewlines(char *string, int length)
+{
+    int newline_count = 0;
+    int i = 0;
+    
+#if GENERATOR_AVX2
+    __m256i newline = _mm256_set1_epi8('\n');
+    for(; i + 32 <= length; i += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((__m256i *)(string + i));
+        newline_count += CountSetBits32((u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, newline)));
+    }
+#elif GENERATOR_SSE2
+    __m128i newline = _mm_set1_epi8('\n');
+    for(; i + 16 <= length; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((__m128i *)(string + i));
+        newline_count += CountSetBits32((u32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)));
+    }
+#endif
+    
+    for(; i < length; ++i)
+    {
+        if(string[i] == '\n')
+        {
+            ++newline_count;
+        }
+    }
+    
+    return newline_count;
+}
+
+typedef struct Tokenizer Tokenizer;
+struct Tokenizer
+{
+    char *at;
+    int line;
+    char *file;
+    int break_text_by_commas;
+    
+    // NOTE(rjf): The parser peeks at the same token several times before consuming it, so
+    // we remember the last token we lexed, along with where we lexed it from.
+    char *cached_token_at;
+    int cached_token_break_text_by_commas;
+    Token cached_token;
+};
+
+typedef struct ParseError ParseError;
+struct ParseError
+{
+    ParseError *next;
+    char *file;
+    int line;
+    char *message;
+};
+
+typedef struct ParseContext ParseContext;
+struct ParseContext
+{
+    Arena arena;
+    
+    // NOTE(rjf): Errors for the page being parsed, in the order they were found.
+    int error_count;
+    ParseError *first_error;
+    ParseError *last_error;
+    
+    // NOTE(rjf): The page being parsed is built up here, then copied into the arena at its
+    // final size, so this storage is reused from one page to the next.
+    PageNodes scratch_nodes;
+    u32 scratch_node_capacity;
+    u32 scratch_extra_capacity;
+};
+
+static void *
+ParseContextAllocateMemory(ParseContext *context, int size)
+{
+    return ArenaPush(&context->arena, size);
+}
+
+// NOTE(rjf): Frees everything the context owns: its arena, and the scratch node storage that
+// lives outside of it.
+static void
+ParseContextRelease(ParseContext *context)
+{
+    ArenaRelease(&context->arena);
+    free(context->scratch_nodes.types);
+    free(context->scratch_nodes.text_style_flags);
+    free(context->scratch_nodes.strings);
+    free(context->scratch_nodes.extra_indices);
+    free(context->scratch_nodes.extras);
+    MemorySet(context, 0, sizeof(*context));
+}
+
+static char *
+ParseContextAllocateCStringCopy(ParseContext *context, char *str)
+{
+    int needed_bytes = CalculateCStringLength(str)+1;
+    char *str_copy = ParseContextAllocateMemory(context, needed_bytes);
+    MemoryCopy(str_copy, str, needed_bytes);
+    return str_copy;
+}
+
+static char *
+ParseContextAllocateCStringCopyN(ParseContext *context, char *str, int n)
+{
+    int needed_bytes = n+1;
+    char *str_copy = ParseContextAllocateMemory(context, needed_bytes);
+    MemoryCopy(str_copy, str, needed_bytes);
+    str_copy[n] = 0;
+    return str_copy;
+}
+
+static void *
+ParseContextAllocateCopy(ParseContext *context, void *data, u64 size)
+{
+    void *copy = ArenaPush(&context->arena, size);
+    MemoryCopy(copy, data, size);
+    return copy;
+}
+
+static void
+ResetParseErrors(ParseContext *context)
+{
+    context->error_count = 0;
+    context->first_error = 0;
+    context->last_error = 0;
+}
+
+static void
+PushParseError(ParseContext *context, Tokenizer *tokenizer, char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int needed_bytes = vsnprintf(0, 0, format, args)+1;
+    va_end(args);
+    
+    char *message = ParseContextAllocateMemory(context, needed_bytes);
+    
+    va_start(args, format);
+    vsnprintf(message, needed_bytes, format, args);
+    va_end(args);
+    
+    message[needed_bytes-1] = 0;
+    
+    ParseError *error = ParseContextAllocateMemory(context, sizeof(ParseError));
+    {
+        error->next = 0;
+        error->file = tokenizer->file;
+        error->line = tokenizer->line;
+        error->message = message;
+    }
+    
+    if(context->last_error)
+    {
+        context->last_error->next = error;
+    }
+    else
+    {
+        context->first_error = error;
+    }
+    context->last_error = error;
+    ++context->error_count;
+}
+
+static Token
+LexToken(char *buffer, int break_text_by_commas)
+{
+    Token token = {0};
+    
+    for(int i = 0; buffer[i]; ++i)
+    {
+        // NOTE(rjf): Newline
+        if(buffer[i] == '\n' && buffer[i+1] == '\n')
+        {
+            token.type = Token_DoubleNewline;
+            token.string = buffer+i;
+            token.string_length = 2;
+            break;
+        }
+        // NOTE(rjf): String Constant
+        else if(buffer[i] == '"')
+        {
+            token.type = Token_StringConstant;
+            token.string = buffer+i;
+            token.string_length = 0;
+            int escaped = 1;
+            for(; (token.string[token.string_length] != '"' || escaped) && token.string[token.string_length];
+                ++token.string_length)
+            {
+                if(escaped)
+                {
+                    escaped = 0;
+                }
+                else
+                {
+                    if(token.string[token.string_length] == '\\')
+                    {
+                        escaped = 1;
+                    }
+                }
+            }
+            
+            // NOTE(rjf): Include the closing quote, unless the string runs to the end of the file.
+            if(token.string[token.string_length])
+            {
+                ++token.string_length;
+            }
+            
+            break;
+        }
+        else if(!CharIsSpace(buffer[i]))
+        {
+            int j = 0;
+            
+            // NOTE(rjf): Tag
+            if(buffer[i] == '@')
+            {
+                j = i+1;
+                for(j=i+1; buffer[j] && !CharIsSpace(buffer[j]) && CharIsAlpha(buffer[j]); ++j);
+                token.type = Token_Tag;
+            }
+            
+            // NOTE(rjf): Symbol
+            else if(CharIsSymbol(buffer[i]))
+            {
+                static char *symbolic_blocks_to_break_out[] =
+                {
+                    "*",
+                    "_",
+                    "`",
+                    "{",
+                    "}",
+                    "|",
+                };
+                
+                for(j=i+1; buffer[j] && CharIsSymbol(buffer[j]); ++j);
+                token.type = Token_Symbol;
+                
+                for(int k = 0; k < sizeof(symbolic_blocks_to_break_out)/sizeof(symbolic_blocks_to_break_out[0]);
+                    ++k)
+                {
+                    int length_to_compare = CalculateCStringLength(symbolic_blocks_to_break_out[k]);
+                    if(CStringMatchCaseSensitiveN(symbolic_blocks_to_break_out[k], buffer+i, length_to_compare))
+                    {
+                        j = i+length_to_compare;
+                        break;
+                    }
+                }
+            }
+            
+            // NOTE(rjf): Text
+            else
+            {
+                j = (int)(FindEndOfTextRun(buffer+i+1, break_text_by_commas) - buffer);
+                token.type = Token_Text;
+                
+                // NOTE(rjf): Add skipped whitespace to text node. The text run itself stops at
+                // newlines, so this skipped whitespace is the only place that can have any.
+                int text_start = i;
+                for(; i > 0 && CharIsSpace(buffer[i-1]); --i);
+                token.lines_traversed = CountNewlines(buffer+i, text_start-i);
+            }
+            
+            if(j != 0)
+            {
+                token.string = buffer+i;
+                token.string_length = j-i;
+                break;
+            }
+        }
+    }
+    
+    // NOTE(rjf): Count the whitespace we skipped to get to the token, too.
+    if(token.type != Token_Text && token.string)
+    {
+        token.lines_traversed = CountNewlines(buffer, (int)(token.string + token.string_length - buffer));
+    }
+    
+    return token;
+}
+
+static Token
+GetNextTokenFromBuffer(Tokenizer *tokenizer)
+{
+    if(tokenizer->cached_token_at != tokenizer->at ||
+       tokenizer->cached_token_break_text_by_commas != tokenizer->break_text_by_commas)
+    {
+        tokenizer->cached_token = LexToken(tokenizer->at, tokenizer->break_text_by_commas);
+        tokenizer->cached_token_at = tokenizer->at;
+        tokenizer->cached_token_break_text_by_commas = tokenizer->break_text_by_commas;
+    }
+    return tokenizer->cached_token;
+}
+
+static Token
+PeekToken(Tokenizer *tokenizer)
+{
+    Token token = GetNextTokenFromBuffer(tokenizer);
+    return token;
+}
+
+static Token
+NextToken(Tokenizer *tokenizer)
+{
+    Token token = GetNextTokenFromBuffer(tokenizer);
+    tokenizer->at = token.string + token.string_length;
+    tokenizer->line += token.lines_traversed;
+    return token;
+}
+
+// NOTE(rjf): A lexing-only pass, for profiling and benchmarks. The parser lexes as it goes,
+// so this is the only way to see what lexing alone costs.
+static u64
+CountTokens(char *file, char *filename)
+{
+    u64 token_count = 0;
+    Tokenizer tokenizer = {0};
+    tokenizer.at = file;
+    tokenizer.line = 1;
+    tokenizer.file = filename;
+    for(;;)
+    {
+        Token token = PeekToken(&tokenizer);
+        if(token.type == Token_None)
+        {
+            break;
+        }
+        NextToken(&tokenizer);
+        ++token_count;
+    }
+    return token_count;
+}
+
+static int
+RequireTokenType(Tokenizer *tokenizer, TokenType type, Token *token_ptr)
+{
+    int match = 0;
+    Token token = GetNextTokenFromBuffer(tokenizer);
+    if(token.type == type)
+    {
+        match = 1;
+        if(token_ptr)
+        {
+            *token_ptr = token;
+        }
+        tokenizer->at = token.string + token.string_length;
+        tokenizer->line += token.lines_traversed;
+    }
+    return match;
+}
+
+static int
+TokenMatch(Token token, char *string)
+{
+    return (token.type != Token_None &&
+            CStringMatchCaseSensitiveN(token.string, string, token.string_length) &&
+            string[token.string_length] == 0);
+}
+
+static int
+RequireToken(Tokenizer *tokenizer, char *string, Token *token_ptr)
+{
+    int match = 0;
+    Token token = GetNextTokenFromBuffer(tokenizer);
+    if(TokenMatch(token, string))
+    {
+        match = 1;
+        if(token_ptr)
+        {
+            *token_ptr = token;
+        }
+        tokenizer->at = token.string + token.string_length;
+        tokenizer->line += token.lines_traversed;
+    }
+    return match;
+}
+
+static void
+SkipToAfterNextComma(Tokenizer *tokenizer)
+{
+    for(int i = 0; tokenizer->at[i]; ++i)
+    {
+        if(tokenizer->at[i] == ',')
+        {
+            tokenizer->at += i+1;
+            break;
+        }
+    }
+}
+
+static void
+TrimQuotationMarks(char **text, int *text_length)
+{
+    if(*text[0] == '"')
+    {
+        *text = *text + 1;
+        *text_length -= 2;
+    }
+}
+
+static int
+ParseTextArgument(ParseContext *context, Tokenizer *tokenizer, char **text, int *text_length)
+{
+    int found_Link = 0;
+    Token link_Tag = {0};
+    if(RequireTokenType(tokenizer, Token_StringConstant, &link_Tag) ||
+       RequireTokenType(tokenizer, Token_Text, &link_Tag))
+    {
+        *text = link_Tag.string;
+        *text_length = link_Tag.string_length;
+        if(*text[0] == '"')
+        {
+            *text = *text + 1;
+            *text_length -= 2;
+        }
+        found_Link = 1;
+    }
+    return found_Link;
+}
+
+static int
+ParseLink(ParseContext *context, Tokenizer *tokenizer, StringHandle *link)
+{
+    char *text = 0;
+    int text_length = 0;
+    int found_link = ParseTextArgument(context, tokenizer, &text, &text_length);
+    if(found_link)
+    {
+        *link = InternString(text, text_length);
+    }
+    return found_link;
+}
+
+typedef struct PageNodeBuilder PageNodeBuilder;
+struct PageNodeBuilder
+{
+    PageNodes *nodes;
+    TextStyleFlags text_style_flags;
+};
+
+static PageNodeID
+PushPageNode(ParseContext *context, PageNodeBuilder *builder, PageNodeType type)
+{
+    PageNodes *nodes = builder->nodes;
+    if(nodes->count >= context->scratch_node_capacity)
+    {
+        u32 capacity = context->scratch_node_capacity ? context->scratch_node_capacity*2 : 1024;
+        nodes->types = realloc(nodes->types, sizeof(u8)*capacity);
+        nodes->text_style_flags = realloc(nodes->text_style_flags, sizeof(u8)*capacity);
+        nodes->strings = realloc(nodes->strings, sizeof(PageNodeString)*capacity);
+        nodes->extra_indices = realloc(nodes->extra_indices, sizeof(u32)*capacity);
+        context->scratch_node_capacity = capacity;
+    }
+    
+    PageNodeID id = nodes->count++;
+    nodes->types[id] = (u8)type;
+    nodes->text_style_flags[id] = (u8)builder->text_style_flags;
+    nodes->strings[id].string = 0;
+    nodes->strings[id].length = 0;
+    nodes->extra_indices[id] = 0;
+    return id;
+}
+
+static u32
+PushPageNodeExtraSlot(ParseContext *context, PageNodes *nodes)
+{
+    if(nodes->extra_count >= context->scratch_extra_capacity)
+    {
+        u32 capacity = context->scratch_extra_capacity ? context->scratch_extra_capacity*2 : 64;
+        nodes->extras = realloc(nodes->extras, sizeof(PageNodeExtra)*capacity);
+        context->scratch_extra_capacity = capacity;
+    }
+    u32 index = nodes->extra_count++;
+    MemorySet(nodes->extras + index, 0, sizeof(PageNodeExtra));
+    return index;
+}
+
+static PageNodeExtra *
+PushPageNodeExtra(ParseContext *context, PageNodeBuilder *builder, PageNodeID id)
+{
+    PageNodes *nodes = builder->nodes;
+    nodes->extra_indices[id] = PushPageNodeExtraSlot(context, nodes);
+    return nodes->extras + nodes->extra_indices[id];
+}
+
+//~ NOTE(rjf): Tags
+//
+// Every tag is described by a row in tag_table, which names the handler that parses the tag's
+// arguments. LookUpTag finds the row for a tag token with a switch on the tag's length and
+// first letter, which narrows things down to at most one candidate; a single string compare
+// then confirms it. Adding a tag means adding a row, and a case to LookUpTag.
+
+typedef struct TagInfo TagInfo;
+
+#define PARSE_TAG_PROC(name) void name(ParseContext *context, Tokenizer *tokenizer, TagInfo *tag, PageNodeBuilder *builder)
+typedef PARSE_TAG_PROC(ParseTagProc);
+
+struct TagInfo
+{
+    char *name;
+    PageNodeType node_type;
+    ParseTagProc *Parse;
+    char *usage_error;
+};
+
+// NOTE(rjf): @PageTitle, @Title, @SubTitle, @Description: {<text>}
+static PARSE_TAG_PROC(ParseTag_Text)
+{
+    Token text = {0};
+    
+    if(RequireToken(tokenizer, "{", 0))
+    {
+        if(RequireTokenType(tokenizer, Token_Text, &text) ||
+           RequireTokenType(tokenizer, Token_StringConstant, &text))
+        {
+            PageNodeID node = PushPageNode(context, builder, tag->node_type);
+            PageNodeString *string = builder->nodes->strings + node;
+            string->string = text.string;
+            string->length = text.string_length;
+            TrimQuotationMarks(&string->string, &string->length);
+        }
+        else
+        {
+            PushParseError(context, tokenizer, "%s", tag->usage_error);
+        }
+        
+        if(!RequireToken(tokenizer, "}", 0))
+        {
+            PushParseError(context, tokenizer, "Missing '}'.");
+        }
+    }
+    else
+    {
+        PushParseError(context, tokenizer, "Expected '{'.");
+    }
+}
+
+// NOTE(rjf): @YouTube, @Image, @ThumbnailImage: {<link>}
+static PARSE_TAG_PROC(ParseTag_Link)
+{
+    if(RequireToken(tokenizer, "{", 0))
+    {
+        PageNodeID node = PushPageNode(context, builder, tag->node_type);
+        PageNodeExtra *extra = PushPageNodeExtra(context, builder, node);
+        
+        if(ParseLink(context, tokenizer, &extra->link.url))
+        {
+            if(!RequireToken(tokenizer, "}", 0))
+            {
+                PushParseError(context, tokenizer, "Missing '}'.");
+            }
+        }
+        else
+        {
+            PushParseError(context, tokenizer, "%s", tag->usage_error);
+        }
+    }
+    else
+    {
+        PushParseError(context, tokenizer, "Expected '{'.");
+    }
+}
+
+// NOTE(rjf): @Code: {<code>}, where the code can contain balanced braces.
+static PARSE_TAG_PROC(ParseTag_Code)
+{
+    Token open_bracket = {0};
+    if(RequireToken(tokenizer, "{", &open_bracket))
+    {
+        char *link = open_bracket.string+1;
+        int link_length = 0;
+        
+        int bracket_stack = 1;
+        for(int i = 0; link[i]; ++i)
+        {
+            if(link[i] == '{')
+            {
+                ++bracket_stack;
+            }
+            else if(link[i] == '}')
+            {
+                --bracket_stack;
+            }
+            
+            if(bracket_stack == 0)
+            {
+                break;
+            }
+            
+            ++link_length;
+        }
+        
+        PageNodeID node = PushPageNode(context, builder, tag->node_type);
+        builder->nodes->strings[node].string = link;
+        builder->nodes->strings[node].length = link_length;
+        
+        tokenizer->at = link + link_length;
+        tokenizer->line += CountNewlines(link, link_length);
+        if(!RequireToken(tokenizer, "}", 0))
+        {
+            PushParseError(context, tokenizer, "Expected } to follow code block.");
+        }
+    }
+    else
+    {
+        PushParseError(context, tokenizer, "%s", tag->usage_error);
+    }
+}
+
+// NOTE(rjf): @Link: {<text>, <link>}
+static PARSE_TAG_PROC(ParseTag_TextAndLink)
+{
+    if(RequireToken(tokenizer, "{", 0))
+    {
+        PageNodeID node = PushPageNode(context, builder, tag->node_type);
+        PageNodeExtra *extra = PushPageNodeExtra(context, builder, node);
+        PageNodeString *string = builder->nodes->strings + node;
+        
+        if(!ParseTextArgument(context, tokenizer, &string->string, &string->length))
+        {
+            PushParseError(context, tokenizer, "%s", tag->usage_error);
+            goto end_parse;
+        }
+        SkipToAfterNextComma(tokenizer);
+        
+        if(!ParseLink(context, tokenizer, &extra->link.url))
+        {
+            PushParseError(context, tokenizer, "%s", tag->usage_error);
+            goto end_parse;
+        }
+        
+        if(!RequireToken(tokenizer, "}", 0))
+        {
+            PushParseError(context, tokenizer, "Missing '}'.");
+        }
+        
+        end_parse:;
+    }
+    else
+    {
+        PushParseError(context, tokenizer, "Expected '{'.");
+    }
+}
+
+// NOTE(rjf): @FeatureButton: {<image>, <text>, <link>}
+static PARSE_TAG_PROC(ParseTag_FeatureButton)
+{
+    if(RequireToken(tokenizer, "{", 0))
+    {
+        PageNodeID node = PushPageNode(context, builder, tag->node_type);
+        PageNodeExtra *extra = PushPageNodeExtra(context, builder, node);
+        PageNodeString *string = builder->nodes->strings + node;
+        
+        if(!ParseLink(context, tokenizer, &extra->feature_button.image_path))
+        {
+            PushParseError(context, tokenizer, "%s", tag->usage_error);
+            goto end_parse;
+        }
+        
+        SkipToAfterNextComma(tokenizer);
+        
+        if(!ParseTextArgument(context, tokenizer, &string->string, &string->length))
+        {
+            PushParseError(context, tokenizer, "%s", tag->usage_error);
+            goto end_parse;
+        }
+        
+        SkipToAfterNextComma(tokenizer);
+        
+        if(!ParseLink(context, tokenizer, &extra->feature_button.link))
+        {
+            PushParseError(context, tokenizer, "%s", tag->usage_error);
+            goto end_parse;
+        }
+        
+        if(!RequireToken(tokenizer, "}", 0))
+        {
+            PushParseError(context, tokenizer, "Missing '}'.");
+        }
+        
+        end_parse:;
+    }
+    else
+    {
+        PushParseError(context, tokenizer, "Expected '{'.");
+    }
+}
+
+// NOTE(rjf): @Lister: {"<filename prefix>"}
+static PARSE_TAG_PROC(ParseTag_Lister)
+{
+    Token open_bracket = {0};
+    if(RequireToken(tokenizer, "{", &open_bracket))
+    {
+        char *text = 0;
+        int text_length = 0;
+        
+        text = open_bracket.string+1;
+        int found_prefix = 0;
+        for(int i = 0; text[i] && text[i] != '}'; ++i)
+        {
+            if(text[i] == '"')
+            {
+                text = text+i+1;
+                found_prefix = 1;
+                break;
+            }
+        }
+        if(!found_prefix)
+        {
+            PushParseError(context, tokenizer, "%s", tag->usage_error);
+            goto end_parse;
+        }
+        for(text_length = 0; text[text_length] && text[text_length] != '"'; ++text_length);
+        
+        PageNodeID node = PushPageNode(context, builder, tag->node_type);
+        PageNodeExtra *extra = PushPageNodeExtra(context, builder, node);
+        extra->lister.prefix = InternString(text, text_length);
+        
+        // NOTE(rjf): Step over the closing quote, if there is one.
+        char *end = text + text_length + (text[text_length] ? 1 : 0);
+        tokenizer->line += CountNewlines(tokenizer->at, (int)(end - tokenizer->at));
+        tokenizer->at = end;
+        
+        // NOTE(rjf): An optional page size splits the listing into numbered and per-year
+        // archive pages.
+        char *at = tokenizer->at;
+        for(; CharIsSpace(*at) && *at != '\n'; ++at);
+        if(*at == ',')
+        {
+            for(++at; CharIsSpace(*at); ++at)
+            {
+                if(*at == '\n')
+                {
+                    ++tokenizer->line;
+                }
+            }
+            int page_size = 0;
+            for(; CharIsDigit(*at); ++at)
+            {
+                page_size = page_size*10 + (*at - '0');
+            }
+            if(page_size <= 0)
+            {
+                PushParseError(context, tokenizer, "Expected a page size after ',' in lister data.");
+            }
+            extra->lister.page_size = page_size;
+            tokenizer->at = at;
+        }
+        
+        if(!RequireToken(tokenizer, "}", 0))
+        {
+            PushParseError(context, tokenizer, "Expected } to follow lister data.");
+        }
+        
+        end_parse:;
+    }
+    else
+    {
+        PushParseError(context, tokenizer, "%s", tag->usage_error);
+    }
+}
+
+// NOTE(rjf): @Date: {<year>/<month>/<day>}
+static PARSE_TAG_PROC(ParseTag_Date)
+{
+    Token open_bracket = {0};
+    if(RequireToken(tokenizer, "{", &open_bracket))
+    {
+        int year = 0;
+        int month = 0;
+        int day = 0;
+        
+        char *str = open_bracket.string+1;
+        
+        for(int i = 0; str[i]; ++i)
+        {
+            if(CharIsDigit(str[i]))
+            {
+                char num_str[32] = {0};
+                int j = 0;
+                for(; str[i+j] && j < sizeof(num_str) && CharIsDigit(str[j]); ++j)
+                {
+                    num_str[j] = str[i+j];
+                }
+                year = CStringToInt(num_str);
+                str += i+j+1;
+                break;
+            }
+        }
+        
+        for(int i = 0; str[i]; ++i)
+        {
+            if(CharIsDigit(str[i]))
+            {
+                char num_str[32] = {0};
+                int j = 0;
+                for(; str[i+j] && j < sizeof(num_str) && CharIsDigit(str[j]); ++j)
+                {
+                    num_str[j] = str[i+j];
+                }
+                month = CStringToInt(num_str);
+                str += i+j+1;
+                break;
+            }
+        }
+        
+        for(int i = 0; str[i]; ++i)
+        {
+            if(CharIsDigit(str[i]))
+            {
+                char num_str[32] = {0};
+                int j = 0;
+                for(; str[i+j] && j < sizeof(num_str) && CharIsDigit(str[j]); ++j)
+                {
+                    num_str[j] = str[i+j];
+                }
+                day = CStringToInt(num_str);
+                str += i+j;
+                break;
+            }
+        }
+        
+        PageNodeID node = PushPageNode(context, builder, tag->node_type);
+        PageNodeExtra *extra = PushPageNodeExtra(context, builder, node);
+        builder->nodes->strings[node].string = "";
+        builder->nodes->strings[node].length = 0;
+        extra->date.year = year;
+        extra->date.month = month;
+        extra->date.day = day;
+        
+        tokenizer->at = str;
+        if(!RequireToken(tokenizer, "}", 0))
+        {
+            PushParseError(context, tokenizer, "Expected '}' to follow date data.");
+        }
+    }
+    else
+    {
+        PushParseError(context, tokenizer, "%s", tag->usage_error);
+    }
+}
+
+typedef enum TagKind
+{
+    Tag_PageTitle,
+    Tag_Title,
+    Tag_SubTitle,
+    Tag_Description,
+    Tag_YouTube,
+    Tag_Image,
+    Tag_ThumbnailImage,
+    Tag_Code,
+    Tag_Link,
+    Tag_FeatureButton,
+    Tag_Lister,
+    Tag_Date,
+    Tag_COUNT
+}
+TagKind;
+
+static TagInfo tag_table[Tag_COUNT] =
+{
+    { "@PageTitle",      PageNodeType_PageTitle,      ParseTag_Text,          "A page title tag expects {<title text>} to follow." },
+    { "@Title",          PageNodeType_Title,          ParseTag_Text,          "A title tag expects {<title text>} to follow." },
+    { "@SubTitle",       PageNodeType_SubTitle,       ParseTag_Text,          "A sub-title tag expects {<sub-title text>} to follow." },
+    { "@Description",    PageNodeType_Description,    ParseTag_Text,          "A description tag expects {<description text>} to follow." },
+    { "@YouTube",        PageNodeType_YouTube,        ParseTag_Link,          "A YouTube tag expects {<youtube link>} to follow." },
+    { "@Image",          PageNodeType_Image,          ParseTag_Link,          "An image tag expects {<image link>} to follow." },
+    { "@ThumbnailImage", PageNodeType_ThumbnailImage, ParseTag_Link,          "An image tag expects {<image link>} to follow." },
+    { "@Code",           PageNodeType_Code,           ParseTag_Code,          "A code tag expects {<code>} to follow." },
+    { "@Link",           PageNodeType_Link,           ParseTag_TextAndLink,   "A link tag expects {<text>, <link>} to follow." },
+    { "@FeatureButton",  PageNodeType_FeatureButton,  ParseTag_FeatureButton, "A feature button tag expects {<image>, <text>, <link>} to follow." },
+    { "@Lister",         PageNodeType_Lister,         ParseTag_Lister,        "A lister tag expects {\"<filename prefix>\"} or {\"<filename prefix>\", <page size>} to follow." },
+    { "@Date",           PageNodeType_Date,           ParseTag_Date,          "A date tag expects {<year>/<month>/<day>} to follow." },
+};
+
+static TagInfo *
+LookUpTag(Token tag)
+{
+    TagInfo *result = 0;
+    
+    if(tag.string_length >= 2)
+    {
+        TagKind kind = Tag_COUNT;
+        char first = tag.string[1];
+        switch(tag.string_length)
+        {
+            case 5:
+            {
+                kind = (first == 'C' ? Tag_Code :
+                        first == 'L' ? Tag_Link :
+                        first == 'D' ? Tag_Date : Tag_COUNT);
+                break;
+            }
+            case 6:
+            {
+                kind = (first == 'T' ? Tag_Title :
+                        first == 'I' ? Tag_Image : Tag_COUNT);
+                break;
+            }
+            case 7:  { kind = first == 'L' ? Tag_Lister         : Tag_COUNT; break; }
+            case 8:  { kind = first == 'Y' ? Tag_YouTube        : Tag_COUNT; break; }
+            case 9:  { kind = first == 'S' ? Tag_SubTitle       : Tag_COUNT; break; }
+            case 10: { kind = first == 'P' ? Tag_PageTitle      : Tag_COUNT; break; }
+            case 12: { kind = first == 'D' ? Tag_Description    : Tag_COUNT; break; }
+            case 14: { kind = first == 'F' ? Tag_FeatureButton  : Tag_COUNT; break; }
+            case 15: { kind = first == 'T' ? Tag_ThumbnailImage : Tag_COUNT; break; }
+            default: break;
+        }
+        
+        if(kind != Tag_COUNT && TokenMatch(tag, tag_table[kind].name))
+        {
+            result = tag_table + kind;
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(rjf): Error recovery. Skips to just after the next '}', or to the next paragraph break,
+// whichever comes first.
+static void
+SkipToEndOfTag(Tokenizer *tokenizer)
+{
+    for(;;)
+    {
+        Token token = PeekToken(tokenizer);
+        if(token.type == Token_None || token.type == Token_DoubleNewline)
+        {
+            break;
+        }
+        NextToken(tokenizer);
+        if(token.type == Token_Symbol && TokenMatch(token, "}"))
+        {
+            break;
+        }
+    }
+}
+
+static PageNodes *
+ParseText(ParseContext *context, Tokenizer *tokenizer)
+{
+    PageNodeBuilder builder = {0};
+    builder.nodes = &context->scratch_nodes;
+    builder.nodes->count = 0;
+    builder.nodes->extra_count = 0;
+    PushPageNodeExtraSlot(context, builder.nodes);
+    
+    Token token = PeekToken(tokenizer);
+    
+    while(token.type != Token_None)
+    {
+        Token tag = {0};
+        Token symbol = {0};
+        Token text = {0};
+        
+        if(RequireTokenType(tokenizer, Token_Tag, &tag))
+        {
+            int error_count = context->error_count;
+            TagInfo *tag_info = LookUpTag(tag);
+            if(tag_info)
+            {
+                tag_info->Parse(context, tokenizer, tag_info, &builder);
+            }
+            else
+            {
+                PushParseError(context, tokenizer, "Malformed tag \"%.*s\".", tag.string_length, tag.string);
+            }
+            
+            // NOTE(rjf): Tags consume their closing '}' last, so if one went wrong and we
+            // aren't just past a '}', the rest of the tag is still ahead of us. Skip it, so
+            // that it isn't read as page text and doesn't produce more errors.
+            if(context->error_count > error_count && tokenizer->at[-1] != '}')
+            {
+                SkipToEndOfTag(tokenizer);
+            }
+        }
+        else if(RequireTokenType(tokenizer, Token_Text, &text))
+        {
+            PageNodeID node = PushPageNode(context, &builder, PageNodeType_Text);
+            builder.nodes->strings[node].string = text.string;
+            builder.nodes->strings[node].length = text.string_length;
+        }
+        else if(RequireTokenType(tokenizer, Token_Symbol, &symbol))
+        {
+            if(TokenMatch(symbol, "*"))
+            {
+                builder.text_style_flags ^= TextStyleFlag_Italics;
+            }
+            else if(TokenMatch(symbol, "|"))
+            {
+                builder.text_style_flags ^= TextStyleFlag_Underline;
+            }
+            else if(TokenMatch(symbol, "`"))
+            {
+                builder.text_style_flags ^= TextStyleFlag_Monospace;
+            }
+            else
+            {
+                PushParseError(context, tokenizer, "Unexpected symbol '%.*s'", symbol.string_length,
+                               symbol.string);
+            }
+        }
+        else if(RequireTokenType(tokenizer, Token_DoubleNewline, &text))
+        {
+            PushPageNode(context, &builder, PageNodeType_ParagraphBreak);
+        }
+        else if(RequireTokenType(tokenizer, Token_StringConstant, &text))
+        {
+            // NOTE(rjf): Quotes outside of a tag are just part of the text.
+            if(text.string[text.string_length-1] == '"' && text.string_length > 1)
+            {
+                PageNodeID node = PushPageNode(context, &builder, PageNodeType_Text);
+                builder.nodes->strings[node].string = text.string;
+                builder.nodes->strings[node].length = text.string_length;
+            }
+            else
+            {
+                // NOTE(rjf): The string ran to the end of the file, so the tokenizer is past
+                // it. Report the line of its opening quote instead.
+                Tokenizer opening = *tokenizer;
+                opening.line -= CountNewlines(text.string, text.string_length);
+                PushParseError(context, &opening, "Unterminated string constant.");
+            }
+        }
+        
+        token = PeekToken(tokenizer);
+    }
+    
+    PageNodes *scratch = builder.nodes;
+    PageNodes *nodes = ParseContextAllocateMemory(context, sizeof(PageNodes));
+    nodes->count = scratch->count;
+    nodes->types = ParseContextAllocateCopy(context, scratch->types, sizeof(u8)*scratch->count);
+    nodes->text_style_flags = ParseContextAllocateCopy(context, scratch->text_style_flags, sizeof(u8)*scratch->count);
+    nodes->strings = ParseContextAllocateCopy(context, scratch->strings, sizeof(PageNodeString)*scratch->count);
+    nodes->extra_indices = ParseContextAllocateCopy(context, scratch->extra_indices, sizeof(u32)*scratch->count);
+    nodes->extra_count = scratch->extra_count;
+    nodes->extras = ParseContextAllocateCopy(context, scratch->extras, sizeof(PageNodeExtra)*scratch->extra_count);
+    return nodes;
+}
+
+typedef struct FileProcessData FileProcessData;
+struct FileProcessData
+{
+    InputType input_type;
+    OutputFlags output_flags;
+    char *filename_no_extension;
+    char *html_output_path;
+    char *md_output_path;
+    char *bbcode_output_path;
+    char *html_header;
+    char *html_footer;
+    int worker_index;
+};
+
+// NOTE(rjf): Everything about a page that is only needed while parsing it, emitting it, or
+// reporting on it. ProcessedFile is what gets sorted and scanned by listers, so it keeps just
+// the per-page metadata, and points at this.
+typedef struct ProcessedFileCold ProcessedFileCold;
+struct ProcessedFileCold
+{
+    FileData source_file;
+    char *description;
+    
+    // NOTE(rjf): Parse Errors
+    int error_count;
+    ParseError *errors;
+    
+    // NOTE(rjf): Incremental Build Data
+    u64 content_hash;
+    u64 html_output_hash;
+    int archive_output_count;
+    u64 *archive_output_hashes;
+    
+    // NOTE(rjf): HTML Output
+    char *html_header;
+    char *html_footer;
+    char *html_output_path;
+    
+    // NOTE(rjf): Other Formats (TODO)
+    char *markdown_output_path;
+    FILE *markdown_output_file;
+    char *bbcode_output_path;
+    FILE *bbcode_output_file;
+    
+    // NOTE(rjf): Only filled in with --profile.
+    FileProfile profile;
+};
+
+typedef struct ProcessedFile ProcessedFile;
+struct ProcessedFile
+{
+    // NOTE(rjf): Page Content Format Root
+    PageNodes *nodes;
+    ProcessedFileCold *cold;
+    
+    // NOTE(rjf): File Data
+    char *filename;
+    char *main_title;
+    char *url;
+    char *lister_url;
+    
+    // NOTE(rjf): Date
+    int date_year;
+    int date_month;
+    int date_day;
+    
+    // NOTE(rjf): General Input/Output Data
+    InputType input_type;
+    OutputFlags output_flags;
+    int input_missing;
+    
+    // NOTE(rjf): Lister Archives
+    int lister_page_count;
+    int lister_year_count;
+    int *lister_years;
+};
+
+static int
+ProcessedFileSortFunction(const void *file1_, const void *file2_)
+{
+    int result = 0;
+    
+    const ProcessedFile *file1 = file1_;
+    const ProcessedFile *file2 = file2_;
+    
+    if(file1->date_year < file2->date_year)
+    {
+        result = 1;
+    }
+    else if(file1->date_year == file2->date_year)
+    {
+        if(file1->date_month < file2->date_month)
+        {
+            result = 1;
+        }
+        else if(file1->date_month == file2->date_month)
+        {
+            if(file1->date_day < file2->date_day)
+            {
+                result = 1;
+            }
+            else if(file1->date_day == file2->date_day)
+            {
+                result = 0;
+            }
+            else if(file1->date_day > file2->date_day)
+            {
+                result = -1;
+            }
+        }
+        else if(file1->date_month > file2->date_month)
+        {
+            result = -1;
+        }
+    }
+    else if(file1->date_year > file2->date_year)
+    {
+        result = -1;
+    }
+    
+    return result;
+}
+
+//~ NOTE(rjf): Lister Index
+//
+// A lister shows every page whose filename starts with some prefix, newest first. Instead of
+// having every lister scan every page, once the pages are sorted by date we also sort them by
+// filename, so that the pages for any prefix form one range we can binary search for. Each
+// distinct prefix that a lister uses is looked up once, and its pages are stored in date
+// order, so emitting a lister is just a walk over its results.
+
+typedef struct ListerIndexFile ListerIndexFile;
+struct ListerIndexFile
+{
+    char *filename;
+    int file_index;
+};
+
+typedef struct ListerIndexEntry ListerIndexEntry;
+struct ListerIndexEntry
+{
+    StringHandle prefix;
+    int first_result;
+    int result_count;
+};
+
+typedef struct ListerIndex ListerIndex;
+struct ListerIndex
+{
+    ProcessedFile *files;
+    int file_count;
+    ListerIndexFile *files_by_filename;
+    
+    // NOTE(rjf): Open-addressed on the prefix, so table_size is always a power of two.
+    int table_size;
+    ListerIndexEntry *table;
+    
+    // NOTE(rjf): Indices into files, in date order, grouped by entry.
+    int result_count;
+    int *results;
+    
+    // NOTE(rjf): Archive years for pages with paginated listers, newest first, grouped by page.
+    int year_count;
+    int *years;
+    
+    // NOTE(rjf): Every page's own output path, sorted. Archive pages are named after the page
+    // that lists them (blog_2.html), so they could land on an input's page (blog_2.rxw).
+    int output_path_count;
+    char **output_paths;
+};
+
+// NOTE(rjf): Which slice of a page's paginated listers is being emitted. Output 0 is the
+// page itself, which shows the first page of results. Outputs after that are the remaining
+// numbered pages, and then one page per year.
+typedef struct ListerView ListerView;
+struct ListerView
+{
+    ListerIndex *index;
+    ProcessedFile *page;
+    int page_number;
+    int year;
+};
+
+static int
+ListerIndexFileSortFunction(const void *a_, const void *b_)
+{
+    const ListerIndexFile *a = a_;
+    const ListerIndexFile *b = b_;
+    int result = strcmp(a->filename, b->filename);
+    if(result == 0)
+    {
+        result = a->file_index - b->file_index;
+    }
+    return result;
+}
+
+static int
+IntSortFunction(const void *a_, const void *b_)
+{
+    const int *a = a_;
+    const int *b = b_;
+    return *a - *b;
+}
+
+static int
+YearSortFunction(const void *a_, const void *b_)
+{
+    const int *a = a_;
+    const int *b = b_;
+    return *b - *a;
+}
+
+static int
+CStringSortFunction(const void *a_, const void *b_)
+{
+    char *const *a = a_;
+    char *const *b = b_;
+    return strcmp(*a, *b);
+}
+
+// NOTE(rjf): Prefixes are interned, so the table is keyed on the handle. The empty prefix,
+// handle 0, marks a free slot.
+static ListerIndexEntry *
+ListerIndexSlot(ListerIndex *index, StringHandle prefix)
+{
+    ListerIndexEntry *slot = 0;
+    if(index->table_size)
+    {
+        u64 slot_index = HashU64(HASH_BEGIN, prefix) & (index->table_size-1);
+        for(;; slot_index = (slot_index+1) & (index->table_size-1))
+        {
+            slot = index->table + slot_index;
+            if(!slot->prefix || slot->prefix == prefix)
+            {
+                break;
+            }
+        }
+    }
+    return slot;
+}
+
+static ListerIndexEntry *
+ListerIndexLookUp(ListerIndex *index, StringHandle prefix)
+{
+    ListerIndexEntry *entry = ListerIndexSlot(index, prefix);
+    if(entry && !entry->prefix)
+    {
+        entry = 0;
+    }
+    return entry;
+}
+
+static void
+BuildListerIndex(ListerIndex *index, ProcessedFile *files, int file_count)
+{
+    free(index->files_by_filename);
+    free(index->table);
+    free(index->results);
+    free(index->years);
+    free(index->output_paths);
+    MemorySet(index, 0, sizeof(*index));
+    
+    index->files = files;
+    index->file_count = file_count;
+    
+    for(int i = 0; i < file_count; ++i)
+    {
+        files[i].lister_page_count = 0;
+        files[i].lister_year_count = 0;
+        files[i].lister_years = 0;
+    }
+    
+    int lister_count = 0;
+    for(int i = 0; i < file_count; ++i)
+    {
+        PageNodes *nodes = files[i].nodes;
+        for(PageNodeID node = 0; nodes && node < nodes->count; ++node)
+        {
+            if(nodes->types[node] == PageNodeType_Lister)
+            {
+                ++lister_count;
+            }
+        }
+    }
+    
+    if(lister_count)
+    {
+        index->files_by_filename = malloc(sizeof(ListerIndexFile)*file_count);
+        for(int i = 0; i < file_count; ++i)
+        {
+            index->files_by_filename[i].filename = files[i].filename;
+            index->files_by_filename[i].file_index = i;
+        }
+        QuickSort(index->files_by_filename, file_count, sizeof(ListerIndexFile), ListerIndexFileSortFunction);
+        
+        index->table_size = 16;
+        while(index->table_size < lister_count*2)
+        {
+            index->table_size *= 2;
+        }
+        index->table = calloc(index->table_size, sizeof(ListerIndexEntry));
+        
+        int results_capacity = 0;
+        for(int i = 0; i < file_count; ++i)
+        {
+            PageNodes *nodes = files[i].nodes;
+            for(PageNodeID node = 0; nodes && node < nodes->count; ++node)
+            {
+                if(nodes->types[node] != PageNodeType_Lister)
+                {
+                    continue;
+                }
+                StringHandle prefix_handle = PageNodeGetExtra(nodes, node)->lister.prefix;
+                if(!prefix_handle)
+                {
+                    continue;
+                }
+                
+                ListerIndexEntry *entry = ListerIndexSlot(index, prefix_handle);
+                if(entry->prefix)
+                {
+                    continue;
+                }
+                
+                char *prefix = GetInternedString(prefix_handle)->string;
+                int prefix_length = GetInternedString(prefix_handle)->length;
+                
+                // NOTE(rjf): Find the range of filenames that start with the prefix.
+                int first = 0;
+                int last = file_count;
+                for(int high = file_count; first < high;)
+                {
+                    int middle = first + (high-first)/2;
+                    if(strncmp(index->files_by_filename[middle].filename, prefix, prefix_length) < 0)
+                    {
+                        first = middle+1;
+                    }
+                    else
+                    {
+                        high = middle;
+                    }
+                }
+                for(int low = first; low < last;)
+                {
+                    int middle = low + (last-low)/2;
+                    if(strncmp(index->files_by_filename[middle].filename, prefix, prefix_length) <= 0)
+                    {
+                        low = middle+1;
+                    }
+                    else
+                    {
+                        last = middle;
+                    }
+                }
+                
+                entry->prefix = prefix_handle;
+                entry->first_result = index->result_count;
+                entry->result_count = last - first;
+                
+                if(index->result_count + entry->result_count > results_capacity)
+                {
+                    results_capacity = (index->result_count + entry->result_count)*2;
+                    index->results = realloc(index->results, sizeof(int)*results_capacity);
+                }
+                int *results = index->results + entry->first_result;
+                for(int j = 0; j < entry->result_count; ++j)
+                {
+                    results[j] = index->files_by_filename[first+j].file_index;
+                }
+                QuickSort(results, entry->result_count, sizeof(int), IntSortFunction);
+                index->result_count += entry->result_count;
+            }
+        }
+        
+        // NOTE(rjf): Work out how many numbered pages each page's paginated listers need, and
+        // which years they cover. Undated pages only show up on the numbered pages.
+        int years_capacity = 0;
+        int *first_year = malloc(sizeof(int)*file_count);
+        for(int i = 0; i < file_count; ++i)
+        {
+            ProcessedFile *file = files+i;
+            first_year[i] = index->year_count;
+            PageNodes *nodes = file->nodes;
+            for(PageNodeID node = 0; nodes && node < nodes->count; ++node)
+            {
+                if(nodes->types[node] != PageNodeType_Lister)
+                {
+                    continue;
+                }
+                int page_size = PageNodeGetExtra(nodes, node)->lister.page_size;
+                if(page_size <= 0)
+                {
+                    continue;
+                }
+                
+                ListerIndexEntry *entry = ListerIndexLookUp(index, PageNodeGetExtra(nodes, node)->lister.prefix);
+                int result_count = entry ? entry->result_count : 0;
+                int page_count = result_count > 0 ? (result_count + page_size-1) / page_size : 1;
+                if(file->lister_page_count < page_count)
+                {
+                    file->lister_page_count = page_count;
+                }
+                
+                for(int j = 0; j < result_count; ++j)
+                {
+                    int year = files[index->results[entry->first_result + j]].date_year;
+                    int year_is_new = (year != 0);
+                    for(int k = first_year[i]; year_is_new && k < index->year_count; ++k)
+                    {
+                        year_is_new = (index->years[k] != year);
+                    }
+                    if(year_is_new)
+                    {
+                        if(index->year_count >= years_capacity)
+                        {
+                            years_capacity = years_capacity ? years_capacity*2 : 64;
+                            index->years = realloc(index->years, sizeof(int)*years_capacity);
+                        }
+                        index->years[index->year_count++] = year;
+                    }
+                }
+            }
+            file->lister_year_count = index->year_count - first_year[i];
+        }
+        for(int i = 0; i < file_count; ++i)
+        {
+            if(files[i].lister_year_count)
+            {
+                files[i].lister_years = index->years + first_year[i];
+                QuickSort(files[i].lister_years, files[i].lister_year_count, sizeof(int), YearSortFunction);
+            }
+        }
+        free(first_year);
+        
+        index->output_paths = malloc(sizeof(char *)*file_count);
+        for(int i = 0; i < file_count; ++i)
+        {
+            if(files[i].cold->html_output_path)
+            {
+                index->output_paths[index->output_path_count++] = files[i].cold->html_output_path;
+            }
+        }
+        QuickSort(index->output_paths, index->output_path_count, sizeof(char *), CStringSortFunction);
+    }
+}
+
+static int
+ListerIndexOutputPathIsTaken(ListerIndex *index, char *path)
+{
+    int low = 0;
+    int high = index->output_path_count;
+    while(low < high)
+    {
+        int middle = low + (high-low)/2;
+        if(strcmp(index->output_paths[middle], path) < 0)
+        {
+            low = middle+1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return (low < index->output_path_count && strcmp(index->output_paths[low], path) == 0);
+}
+
+static int
+ListerOutputCount(ProcessedFile *page)
+{
+    int page_count = page->lister_page_count > 1 ? page->lister_page_count : 1;
+    return page_count + page->lister_year_count;
+}
+
+static ListerView
+ListerViewForOutput(ListerIndex *index, ProcessedFile *page, int output_index)
+{
+    ListerView view = {0};
+    view.index = index;
+    view.page = page;
+    int page_count = page->lister_page_count > 1 ? page->lister_page_count : 1;
+    if(output_index < page_count)
+    {
+        view.page_number = output_index;
+    }
+    else
+    {
+        view.year = page->lister_years[output_index - page_count];
+    }
+    return view;
+}
+
+// NOTE(rjf): blog.html is followed by blog_2.html, blog_3.html, ..., and blog_year_2019.html.
+// Returns 0 if the path did not fit in result.
+static int
+FormatListerOutputPath(char *path, ListerView *view, char *result, int result_size)
+{
+    int extension_start = (int)CalculateCStringLength(path);
+    for(int i = 0; path[i]; ++i)
+    {
+        if(path[i] == '.')
+        {
+            extension_start = i;
+        }
+        else if(path[i] == '/')
+        {
+            extension_start = (int)CalculateCStringLength(path);
+        }
+    }
+    
+    int length = 0;
+    if(view->year)
+    {
+        length = snprintf(result, result_size, "%.*s_year_%i%s", extension_start, path, view->year, path + extension_start);
+    }
+    else if(view->page_number)
+    {
+        length = snprintf(result, result_size, "%.*s_%i%s", extension_start, path, view->page_number+1, path + extension_start);
+    }
+    else
+    {
+        length = snprintf(result, result_size, "%s", path);
+    }
+    return (length >= 0 && length < result_size);
+}
+
+// NOTE(rjf): An archive page whose path belongs to an input's own page is neither written nor
+// linked, so that page always wins.
+static int
+ListerOutputIsShadowed(ListerIndex *index, ListerView *view)
+{
+    int shadowed = 0;
+    if(view->page_number || view->year)
+    {
+        char path[1024] = {0};
+        shadowed = (FormatListerOutputPath(view->page->cold->html_output_path, view, path, sizeof(path)) &&
+                    ListerIndexOutputPathIsTaken(index, path));
+    }
+    return shadowed;
+}
+
+static void
+OutputListerNavigation(OutputBuffer *buffer, ListerView *view)
+{
+    ProcessedFile *page = view->page;
+    int output_count = ListerOutputCount(page);
+    if(output_count > 1)
+    {
+        OutputBufferAppendString(buffer, "<div class=\"lister_navigation\">\n");
+        for(int i = 0; i < output_count; ++i)
+        {
+            ListerView target = ListerViewForOutput(view->index, page, i);
+            int label = target.year ? target.year : target.page_number+1;
+            if(target.page_number == view->page_number && target.year == view->year)
+            {
+                OutputBufferAppendString(buffer, "<span class=\"lister_current_page\">");
+                OutputBufferAppendInt(buffer, label);
+                OutputBufferAppendString(buffer, "</span>\n");
+            }
+            else
+            {
+                char url[1024] = {0};
+                if(!FormatListerOutputPath(page->lister_url, &target, url, sizeof(url)) ||
+                   ListerOutputIsShadowed(view->index, &target))
+                {
+                    continue;
+                }
+                OutputBufferAppendString(buffer, target.year ? "<a class=\"lister_year_link\" href=\"" :
+                                         "<a class=\"lister_page_link\" href=\"");
+                OutputBufferAppendString(buffer, url);
+                OutputBufferAppendString(buffer, "\">");
+                OutputBufferAppendInt(buffer, label);
+                OutputBufferAppendString(buffer, "</a>\n");
+            }
+        }
+        OutputBufferAppendString(buffer, "</div>\n");
+    }
+}
+
+// NOTE(rjf): The elements and classes that each node type can emit, and those around every
+// page. These decide which CSS rules a page gets inlined, and which survive --minify at all
+// (see CSS and JS Minification), so anything added to the emitter has to be added here too.
+static char *html_page_frame_names = "html head body meta title link style noscript div page_content";
+static char *html_page_node_names[] =
+{
+    [PageNodeType_Title]          = "h1 h2",
+    [PageNodeType_SubTitle]       = "h2 hr br",
+    [PageNodeType_Text]           = "p strong u i span monospace",
+    [PageNodeType_UnorderedList]  = "ul li",
+    [PageNodeType_OrderedList]    = "ol li",
+    [PageNodeType_Code]           = "div code pre span code_text",
+    [PageNodeType_YouTube]        = "div youtube iframe",
+    [PageNodeType_Image]          = "div image_container img image",
+    [PageNodeType_ThumbnailImage] = "div thumbnail_image_container a img thumbnail_image",
+    [PageNodeType_Link]           = "div standalone_link_container a link",
+    [PageNodeType_FeatureButton]  = "div feature_button a feature_button_image feature_button_text",
+    [PageNodeType_Lister]         = "a lister_link div lister_navigation span lister_current_page lister_year_link lister_page_link",
+    [PageNodeType_Date]           = "h2",
+};
+
+static void
+OutputHTMLFromPageNodes_(PageNodes *nodes, PageNodeID first, PageNodeID end, OutputBuffer *buffer, ListerView *listers)
+{
+    int paragraph_active = 0;
+    int thumbnails_active = 0;
+    int found_Title = 0;
+    
+    PageNodeExtra *date = 0;
+    for(PageNodeID node = first; node < end; node = PageNodeNextSibling(nodes, node))
+    {
+        if(nodes->types[node] == PageNodeType_Date)
+        {
+            date = PageNodeGetExtra(nodes, node);
+            break;
+        }
+    }
+    
+    static char *month_names[] =
+    {
+        "January",
+        "February",
+        "March",
+        "April",
+        "May",
+        "June",
+        "July",
+        "August",
+        "September",
+        "October",
+        "November",
+        "December",
+    };
+    
+    PageNodeID previous_node = end;
+    
+    for(PageNodeID node = first; node < end; previous_node = node, node = PageNodeNextSibling(nodes, node))
+    {
+        PageNodeID next = PageNodeNextSibling(nodes, node);
+        char *string = nodes->strings[node].string;
+        int string_length = nodes->strings[node].length;
+        TextStyleFlags text_style_flags = nodes->text_style_flags[node];
+        PageNodeExtra *extra = PageNodeGetExtra(nodes, node);
+        
+        switch(nodes->types[node])
+        {
+            case PageNodeType_Title:
+            {
+                OutputBufferAppendString(buffer, "<h1>");
+                OutputBufferAppendStringN(buffer, string, string_length);
+                OutputBufferAppendString(buffer, "</h1>\n");
+                
+                if(!found_Title && date)
+                {
+                    found_Title = 1;
+                    OutputBufferAppendString(buffer, "<h2>");
+                    OutputBufferAppendInt(buffer, date->date.day);
+                    OutputBufferAppendString(buffer, " ");
+                    OutputBufferAppendString(buffer, month_names[date->date.month-1]);
+                    OutputBufferAppendString(buffer, " ");
+                    OutputBufferAppendInt(buffer, date->date.year);
+                    OutputBufferAppendString(buffer, "</h2>\n");
+                }
+                
+                break;
+            }
+            case PageNodeType_SubTitle:
+            {
+                if(previous_node < end && nodes->types[previous_node] != PageNodeType_Title)
+                {
+                    OutputBufferAppendString(buffer, "<hr><br>\n");
+                }
+                OutputBufferAppendString(buffer, "<h2>");
+                OutputBufferAppendStringN(buffer, string, string_length);
+                OutputBufferAppendString(buffer, "</h2>\n");
+                break;
+            }
+            case PageNodeType_Text:
+            {
+                if(!paragraph_active)
+                {
+                    OutputBufferAppendString(buffer, "<p>");
+                    paragraph_active = 1;
+                }
+                
+                if(text_style_flags & TextStyleFlag_Bold)
+                {
+                    OutputBufferAppendString(buffer, "<strong>");
+                }
+                if(text_style_flags & TextStyleFlag_Underline)
+                {
+                    OutputBufferAppendString(buffer, "<u>");
+                }
+                if(text_style_flags & TextStyleFlag_Italics)
+                {
+                    OutputBufferAppendString(buffer, "<i>");
+                }
+                if(text_style_flags & TextStyleFlag_Monospace)
+                {
+                    OutputBufferAppendString(buffer, "<span class=\"monospace\">");
+                }
+                OutputBufferAppendStringN(buffer, string, string_length);
+                if(text_style_flags & TextStyleFlag_Monospace)
+                {
+                    OutputBufferAppendString(buffer, "</span>");
+                }
+                if(text_style_flags & TextStyleFlag_Italics)
+                {
+                    OutputBufferAppendString(buffer, "</i>");
+                }
+                if(text_style_flags & TextStyleFlag_Underline)
+                {
+                    OutputBufferAppendString(buffer, "</u>");
+                }
+                if(text_style_flags & TextStyleFlag_Bold)
+                {
+                    OutputBufferAppendString(buffer, "</strong>");
+                }
+                
+                if(next >= end || (nodes->types[next] != PageNodeType_Text &&
+                                   nodes->types[next] != PageNodeType_Link))
+                {
+                    OutputBufferAppendString(buffer, "</p>");
+                    paragraph_active = 0;
+                }
+                
+                break;
+            }
+            case PageNodeType_ParagraphBreak:
+            {
+                if(paragraph_active)
+                {
+                    OutputBufferAppendString(buffer, "</p>");
+                    paragraph_active = 0;
+                }
+                break;
+            }
+            case PageNodeType_UnorderedList:
+            {
+                OutputBufferAppendString(buffer, "<ul>\n");
+                for(PageNodeID list_item = node+1; list_item < next;
+                    list_item = PageNodeNextSibling(nodes, list_item))
+                {
+                    OutputBufferAppendString(buffer, "<li>");
+                    OutputHTMLFromPageNodes_(nodes, list_item, PageNodeNextSibling(nodes, list_item), buffer, listers);
+                    OutputBufferAppendString(buffer, "</li>");
+                }
+                OutputBufferAppendString(buffer, "</ul>\n");
+                break;
+            }
+            case PageNodeType_OrderedList:
+            {
+                OutputBufferAppendString(buffer, "<ol>\n");
+                for(PageNodeID list_item = node+1; list_item < next;
+                    list_item = PageNodeNextSibling(nodes, list_item))
+                {
+                    OutputBufferAppendString(buffer, "<li>");
+                    OutputHTMLFromPageNodes_(nodes, list_item, PageNodeNextSibling(nodes, list_item), buffer, listers);
+                    OutputBufferAppendString(buffer, "</li>");
+                }
+                OutputBufferAppendString(buffer, "</ol>\n");
+                break;
+            }
+            case PageNodeType_Code:
+            {
+                OutputBufferAppendString(buffer, "<div class=\"code\"><pre>");
+                
+                enum
+                {
+                    CODE_TYPE_default,
+                    CODE_TYPE_line_comment,
+                    CODE_TYPE_block_comment,
+                    CODE_TYPE_keyword,
+                    CODE_TYPE_constant,
+                    CODE_TYPE_Tag,
+                };
+                
+                int code_type = CODE_TYPE_default;
+                
+                for(int i = 0; i < string_length;)
+                {
+                    int token_length = 1;
+                    
+                    code_type = CODE_TYPE_default;
+                    
+                    if(string[i] == '/' && string[i+1] == '/')
+                    {
+                        code_type = CODE_TYPE_line_comment;
+                        for(;
+                            string[i+token_length] &&
+                            string[i+token_length] != '\n';
+                            ++token_length);
+                        OutputBufferAppendString(buffer, "<span class=\"code_text\" style=\"color: #8cba53;\">");
+                    }
+                    else if(string[i] == '/' && string[i+1] == '*')
+                    {
+                        code_type = CODE_TYPE_block_comment;
+                        int nest_level = 1;
+                        for(; string[i+token_length]; ++token_length)
+                        {
+                            if(string[i+token_length] == '*' &&
+                               string[i+token_length+1] == '/')
+                            {
+                                nest_level -= 1;
+                                if(nest_level <= 0)
+                                {
+                                    break;
+                                }
+                            }
+                            else if(string[i+token_length] == '/' &&
+                                    string[i+token_length+1] == '*')
+                            {
+                                nest_level += 1;
+                            }
+                        }
+                        token_length += 2;
+                        OutputBufferAppendString(buffer, "<span class=\"code_text\" style=\"color: #8cba53;\">");
+                    }
+                    else if(CharIsAlpha(string[i]) || string[i] == '_')
+                    {
+                        for(;
+                            string[i+token_length] &&
+                            (string[i+token_length] == '_' ||
+                             CharIsAlpha(string[i+token_length]) ||
+                             CharIsDigit(string[i+token_length]));
+                            ++token_length);
+                        
+                        static char *keywords[] =
+                        {
+                            "auto", "break", "case", "char",
+                            "const", "continue", "default", "do", "double",
+                            "else", "enum", "extern", "float",
+                            "for", "goto", "if", "int", "long", "register", "return",
+                            "short", "signed", "sizeof", "static",
+                            "struct", "switch", "typedef", "union", "unsigned",
+                            "void", "volatile", "while",
+                        };
+                        
+                        for(int k = 0; k < sizeof(keywords)/sizeof(keywords[0]); ++k)
+                        {
+                            if(CStringMatchCaseSensitiveN(string+i, keywords[k], token_length) &&
+                               token_length == CalculateCStringLength(keywords[k]))
+                            {
+                                code_type = CODE_TYPE_keyword;
+                                OutputBufferAppendString(buffer, "<span class=\"code_text\" style=\"color: #f4b642;\">");
+                                break;
+                            }
+                        }
+                    }
+                    else if(CharIsDigit(string[i]))
+                    {
+                        for(;
+                            string[i+token_length] &&
+                            (string[i+token_length] == '.' ||
+                             CharIsAlpha(string[i+token_length]) ||
+                             CharIsDigit(string[i+token_length]));
+                            ++token_length);
+                        
+                        code_type = CODE_TYPE_constant;
+                        OutputBufferAppendString(buffer, "<span class=\"code_text\" style=\"color: #82c4e5;\">");
+                    }
+                    else if(string[i] == '"')
+                    {
+                        for(;
+                            string[i+token_length] &&
+                            string[i+token_length] != '"';
+                            ++token_length);
+                        
+                        ++token_length;
+                        
+                        code_type = CODE_TYPE_constant;
+                        OutputBufferAppendString(buffer, "<span class=\"code_text\" style=\"color: #82c4e5;\">");
+                    }
+                    else if(string[i] == '\'')
+                    {
+                        for(;
+                            string[i+token_length] &&
+                            string[i+token_length] != '\'';
+                            ++token_length);
+                        
+                        ++token_length;
+                        
+                        code_type = CODE_TYPE_constant;
+                        OutputBufferAppendString(buffer, "<span class=\"code_text\" style=\"color: #82c4e5;\">");
+                    }
+                    else if(string[i] == '@')
+                    {
+                        int nest_level = 0;
+                        for(; string[i+token_length]; ++token_length)
+                        {
+                            if(string[i+token_length] == '(')
+                            {
+                                nest_level += 1;
+                            }
+                            else if(string[i+token_length] == ')')
+                            {
+                                nest_level -= 1;
+                                if(nest_level <= 0)
+                                {
+                                    break;
+                                }
+                            }
+                            else if(string[i+token_length] <= 32)
+                            {
+                                if(nest_level == 0)
+                                {
+                                    break;
+                                }
+                            }
+                        }
+                        
+                        ++token_length;
+                        
+                        code_type = CODE_TYPE_Tag;
+                        OutputBufferAppendString(buffer, "<span class=\"code_text\" style=\"color: #d86312;\">");
+                    }
+                    
+                    OutputBufferAppendHTMLEscapedN(buffer, string+i, token_length);
+                    
+                    i += token_length;
+                    
+                    if(code_type != CODE_TYPE_default)
+                    {
+                        OutputBufferAppendString(buffer, "</span>");
+                    }
+                }
+                
+                OutputBufferAppendString(buffer, "</pre></div>");
+                
+                break;
+            }
+            case PageNodeType_YouTube:
+            {
+                OutputBufferAppendString(buffer, "<div class=\"youtube\"><iframe width=\"100%\" height=\"315\" src=\"");
+                
+                InternedString *url = GetInternedString(extra->link.url);
+                for(int i = 0; i < url->length; ++i)
+                {
+                    int length = CalculateCStringLength("watch?v=");
+                    if(CStringMatchCaseSensitiveN(url->string+i, "watch?v=", length))
+                    {
+                        OutputBufferAppendString(buffer, "embed/");
+                        i += length-1;
+                    }
+                    else
+                    {
+                        OutputBufferAppendChar(buffer, url->string[i]);
+                    }
+                }
+                
+                OutputBufferAppendString(buffer, "\" frameborder=\"0\" allow=\"accelerometer; autoplay; encrypted-media; gyroscope; picture-in-picture\" allowfullscreen></iframe></div>");
+                break;
+            }
+            case PageNodeType_Image:
+            {
+                InternedString *url = GetInternedString(extra->link.url);
+                OutputBufferAppendString(buffer, "<div class=\"image_container\"><img class=\"image\" src=\"");
+                OutputBufferAppendStringN(buffer, url->string, url->length);
+                OutputBufferAppendString(buffer, "\"></div>\n");
+                break;
+            }
+            case PageNodeType_ThumbnailImage:
+            {
+                if(!thumbnails_active)
+                {
+                    thumbnails_active = 1;
+                    OutputBufferAppendString(buffer, "<div class=\"thumbnail_image_container\">");
+                }
+                InternedString *url = GetInternedString(extra->link.url);
+                OutputBufferAppendString(buffer, "<a href=\"");
+                OutputBufferAppendStringN(buffer, url->string, url->length);
+                OutputBufferAppendString(buffer, "\"><img class=\"thumbnail_image\" src=\"");
+                OutputBufferAppendStringN(buffer, url->string, url->length);
+                OutputBufferAppendString(buffer, "\"></a>");
+                if(thumbnails_active && (next >= end || nodes->types[next] != PageNodeType_ThumbnailImage))
+                {
+                    thumbnails_active = 0;
+                    OutputBufferAppendString(buffer, "</div>\n");
+                }
+                break;
+            }
+            case PageNodeType_Link:
+            {
+                if(!paragraph_active)
+                {
+                    OutputBufferAppendString(buffer, "<div class=\"standalone_link_container\">");
+                }
+                OutputBufferAppendString(buffer, "<a class=\"link\" href=\"");
+                InternedString *url = GetInternedString(extra->link.url);
+                OutputBufferAppendStringN(buffer, url->string, url->length);
+                OutputBufferAppendString(buffer, "\">");
+                OutputBufferAppendStringN(buffer, string, string_length);
+                OutputBufferAppendString(buffer, "</a>");
+                if(!paragraph_active)
+                {
+                    OutputBufferAppendString(buffer, "</div>");
+                }
+                
+                break;
+            }
+            case PageNodeType_FeatureButton:
+            {
+                OutputBufferAppendString(buffer, "<div class=\"feature_button\">\n");
+                OutputBufferAppendString(buffer, "<a href=\"");
+                InternedString *link = GetInternedString(extra->feature_button.link);
+                OutputBufferAppendStringN(buffer, link->string, link->length);
+                OutputBufferAppendString(buffer, "\">\n");
+                
+                OutputBufferAppendString(buffer, "<div class=\"feature_button_image\" style=\"background-image: url('");
+                InternedString *image_path = GetInternedString(extra->feature_button.image_path);
+                OutputBufferAppendStringN(buffer, image_path->string, image_path->length);
+                OutputBufferAppendString(buffer, "');\"></div>\n");
+                
+                OutputBufferAppendString(buffer, "<div class=\"feature_button_text\">\n");
+                OutputBufferAppendStringN(buffer, string, string_length);
+                OutputBufferAppendString(buffer, "\n");
+                OutputBufferAppendString(buffer, "</div>\n");
+                
+                OutputBufferAppendString(buffer, "</a>\n");
+                OutputBufferAppendString(buffer, "</div>\n");
+                break;
+            }
+            case PageNodeType_Lister:
+            {
+                ListerIndex *index = listers->index;
+                ListerIndexEntry *lister = ListerIndexLookUp(index, extra->lister.prefix);
+                int first_result = lister ? lister->first_result : 0;
+                int result_count = lister ? lister->result_count : 0;
+                
+                int page_size = extra->lister.page_size;
+                if(page_size > 0 && listers->year)
+                {
+                    // NOTE(rjf): Results are newest first, so each year is one run of them.
+                    int end = first_result + result_count;
+                    for(; first_result < end && index->files[index->results[first_result]].date_year != listers->year; ++first_result);
+                    for(result_count = 0;
+                        first_result + result_count < end &&
+                        index->files[index->results[first_result + result_count]].date_year == listers->year;
+                        ++result_count);
+                }
+                else if(page_size > 0)
+                {
+                    int skip = listers->page_number * page_size;
+                    skip = skip < result_count ? skip : result_count;
+                    first_result += skip;
+                    result_count -= skip;
+                    result_count = result_count < page_size ? result_count : page_size;
+                }
+                
+                for(int i = 0; i < result_count; ++i)
+                {
+                    ProcessedFile *file = index->files + index->results[first_result + i];
+                    OutputBufferAppendString(buffer, "<a class=\"lister_link\" href=\"");
+                    OutputBufferAppendString(buffer, file->lister_url);
+                    OutputBufferAppendString(buffer, "\">(");
+                    OutputBufferAppendInt(buffer, file->date_year);
+                    OutputBufferAppendString(buffer, "/");
+                    OutputBufferAppendInt(buffer, file->date_month);
+                    OutputBufferAppendString(buffer, "/");
+                    OutputBufferAppendInt(buffer, file->date_day);
+                    OutputBufferAppendString(buffer, ") ");
+                    OutputBufferAppendString(buffer, file->main_title);
+                    OutputBufferAppendString(buffer, "</a>\n");
+                }
+                
+                if(page_size > 0)
+                {
+                    OutputListerNavigation(buffer, listers);
+                }
+                
+                break;
+            }
+            default: break;
+        }
+    }
+}
+
+static void
+OutputHTMLFromPageNodes(PageNodes *nodes, OutputBuffer *buffer, ListerView *listers)
+{
+    OutputHTMLFromPageNodes_(nodes, 0, nodes->count, buffer, listers);
+}
+
+// NOTE(rjf): The critical CSS shared by every page made of the same node types.
+typedef struct CriticalCSS CriticalCSS;
+struct CriticalCSS
+{
+    u32 node_types;
+    char *css;
+    u64 size;
+};
+
+typedef struct SiteInfo SiteInfo;
+struct SiteInfo
+{
+    char *canonical_url;
+    char *main_title;
+    char *author;
+    char *twitter_handle;
+    char* icon_path;
+    
+    // NOTE(rjf): The site stylesheet, whitespace-minified and with url()s made relative to the
+    // pages, when its critical rules are to be inlined (--critical_css).
+    char *critical_css;
+    u64 critical_css_size;
+    
+    // NOTE(rjf): Filled in by PrepareCriticalCSS before pages are emitted, and only read
+    // while they are.
+    CriticalCSS *critical_css_variants;
+    int critical_css_variant_count;
+    int critical_css_variant_capacity;
+};
+
+// NOTE(rjf): Where pages find the stylesheet, and the directory its url()s are relative to.
+#define HTML_STYLESHEET_URL "data/styles.css"
+#define HTML_STYLESHEET_DIRECTORY "data/"
+
+static u32
+PageNodeTypesPresent(PageNodes *nodes)
+{
+    u32 types_present = 0;
+    for(PageNodeID node = 0; nodes && node < nodes->count; ++node)
+    {
+        types_present |= 1u << nodes->types[node];
+    }
+    return types_present;
+}
+
+// NOTE(rjf): Inlines the stylesheet rules that can apply to this page: those whose elements,
+// classes and ids all occur among the node types on the page, the page frame, and the header
+// and footer. Returns 0 for pages it can't know the markup of (HTML inputs), which keep the
+// ordinary render-blocking stylesheet. Pages share a handful of node type combinations at
+// most, so a linear search finds the variant.
+static int
+OutputCriticalCSS(SiteInfo *site_info, ProcessedFile *page, OutputBuffer *buffer)
+{
+    int inlined = 0;
+    if(site_info->critical_css && page->input_type != InputType_HTML)
+    {
+        u32 types_present = PageNodeTypesPresent(page->nodes);
+        for(int i = 0; i < site_info->critical_css_variant_count; ++i)
+        {
+            CriticalCSS *variant = site_info->critical_css_variants + i;
+            if(variant->node_types == types_present)
+            {
+                OutputBufferAppendString(buffer, "<style>");
+                OutputBufferAppendStringN(buffer, variant->css, variant->size);
+                OutputBufferAppendString(buffer, "</style>\n");
+                inlined = 1;
+                break;
+            }
+        }
+    }
+    return inlined;
+}
+
+static void
+OutputHTMLHeader(SiteInfo *site_info, ProcessedFile *page, OutputBuffer *buffer)
+{
+    OutputBufferAppendString(buffer, "<!DOCTYPE html>\n");
+    OutputBufferAppendString(buffer, "<html lang=\"en\">\n");
+    OutputBufferAppendString(buffer, "<head>\n");
+    OutputBufferAppendString(buffer, "<meta charset=\"utf-8\">");
+    // NOTE(bvisness): Consider adding mobile-friendly styles and then adding this line
+    OutputBufferAppendString(buffer, "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">");
+    OutputBufferAppendString(buffer, "<meta name=\"author\" content=\"");
+    OutputBufferAppendString(buffer, site_info->author);
+    OutputBufferAppendString(buffer, "\">\n");
+    OutputBufferAppendString(buffer, "<title>");
+    OutputBufferAppendString(buffer, page->main_title);
+    if(site_info->main_title)
+    {
+        OutputBufferAppendString(buffer, " | ");
+        OutputBufferAppendString(buffer, site_info->main_title);
+    }
+    OutputBufferAppendString(buffer, "</title>\n");
+    OutputBufferAppendString(buffer, "<meta property=\"og:title\" content=\"");
+    OutputBufferAppendString(buffer, page->main_title);
+    OutputBufferAppendString(buffer, "\">\n");
+    OutputBufferAppendString(buffer, "<meta name=\"twitter:title\" content=\"");
+    OutputBufferAppendString(buffer, page->main_title);
+    OutputBufferAppendString(buffer, "\">\n");
+    if (page->cold->description)
+    {
+        OutputBufferAppendString(buffer, "<meta name=\"description\" content=\"");
+        OutputBufferAppendString(buffer, page->cold->description);
+        OutputBufferAppendString(buffer, "\">\n");
+        OutputBufferAppendString(buffer, "<meta property=\"og:description\" content=\"");
+        OutputBufferAppendString(buffer, page->cold->description);
+        OutputBufferAppendString(buffer, "\">\n");
+        OutputBufferAppendString(buffer, "<meta name=\"twitter:description\" content=\"");
+        OutputBufferAppendString(buffer, page->cold->description);
+        OutputBufferAppendString(buffer, "\">\n");
+    }
+    OutputBufferAppendString(buffer, "<link rel=\"canonical\" href=\"");
+    OutputBufferAppendString(buffer, site_info->canonical_url);
+    OutputBufferAppendString(buffer, "/");
+    OutputBufferAppendString(buffer, page->url);
+    OutputBufferAppendString(buffer, "\">\n");
+    OutputBufferAppendString(buffer, "<meta property=\"og:type\" content=\"website\">\n");
+    OutputBufferAppendString(buffer, "<meta property=\"og:url\" content=\"");
+    OutputBufferAppendString(buffer, site_info->canonical_url);
+    OutputBufferAppendString(buffer, "/");
+    OutputBufferAppendString(buffer, page->url);
+    OutputBufferAppendString(buffer, "\">\n");
+    OutputBufferAppendString(buffer, "<meta property=\"og:site_name\" content=\"");
+    OutputBufferAppendString(buffer, site_info->main_title ? site_info->main_title : "");
+    OutputBufferAppendString(buffer, "\">\n");
+    OutputBufferAppendString(buffer, "<meta name=\"twitter:card\" content=\"summary\">\n");
+    OutputBufferAppendString(buffer, "<meta name=\"twitter:site\" content=\"");
+    OutputBufferAppendString(buffer, site_info->twitter_handle ? site_info->twitter_handle : "");
+    OutputBufferAppendString(buffer, "\">\n");
+    if(OutputCriticalCSS(site_info, page, buffer))
+    {
+        // NOTE(rjf): The whole stylesheet then loads without blocking rendering.
+        OutputBufferAppendString(buffer, "<link rel=\"preload\" href=\"" HTML_STYLESHEET_URL "\" as=\"style\" "
+                                 "onload=\"this.onload=null;this.rel='stylesheet'\">\n");
+        OutputBufferAppendString(buffer, "<noscript><link rel=\"stylesheet\" type=\"text/css\" href=\"" HTML_STYLESHEET_URL "\"></noscript>\n");
+    }
+    else
+    {
+        OutputBufferAppendString(buffer, "<link rel=\"stylesheet\" type=\"text/css\" href=\"" HTML_STYLESHEET_URL "\">\n");
+    }
+    if(site_info->icon_path){
+        OutputBufferAppendString(buffer, "<link rel=\"icon\" type=\"image/png\" href=\"");
+        OutputBufferAppendString(buffer, site_info->icon_path);
+        OutputBufferAppendString(buffer, "\">");
+    }
+    OutputBufferAppendString(buffer, "</head>\n");
+    OutputBufferAppendString(buffer, "<body>\n");
+    if(page->cold->html_header)
+    {
+        OutputBufferAppendString(buffer, page->cold->html_header);
+    }
+    OutputBufferAppendString(buffer, "<div class=\"page_content\">\n");
+}
+
+static void
+OutputHTMLFooter(ProcessedFile *page, OutputBuffer *buffer)
+{
+    OutputBufferAppendString(buffer, "</div>\n");
+    if(page->cold->html_footer)
+    {
+        OutputBufferAppendString(buffer, page->cold->html_footer);
+    }
+    OutputBufferAppendString(buffer, "</body>\n");
+    OutputBufferAppendString(buffer, "</html>\n");
+}
+
+static ProcessedFile
+ProcessFile(char *filename, char *file, FileProcessData *process_data, ParseContext *context)
+{
+    u64 arena_used_size = profiler.enabled ? ArenaUsedSize(&context->arena) : 0;
+    int worker_index = process_data->worker_index;
+    
+    ProcessedFile processed_file = {0};
+    processed_file.cold = ParseContextAllocateMemory(context, sizeof(ProcessedFileCold));
+    MemorySet(processed_file.cold, 0, sizeof(ProcessedFileCold));
+    processed_file.filename = filename;
+    processed_file.output_flags = process_data->output_flags;
+    processed_file.cold->html_header = process_data->html_header;
+    processed_file.cold->html_footer = process_data->html_footer;
+    processed_file.input_type = process_data->input_type;
+    
+    // NOTE(rjf): Raw HTML inputs aren't loaded at all; OutputFileJob copies them straight
+    // from the input file into the page.
+    if(file && process_data->input_type == InputType_RXW)
+    {
+        // NOTE(rjf): Errors are tracked per-file, so that one broken page doesn't stop every
+        // page after it from parsing, and so that the errors we find don't depend on which
+        // worker happened to parse which files.
+        ResetParseErrors(context);
+        
+        Tokenizer tokenizer_ = {0};
+        Tokenizer *tokenizer = &tokenizer_;
+        tokenizer->at = file;
+        tokenizer->line = 1;
+        tokenizer->file = filename;
+        
+        FileProfile *profile = &processed_file.cold->profile;
+        if(profiler.enabled)
+        {
+            u64 tokenize_start_time = ProfileBegin();
+            profile->token_count = CountTokens(file, filename);
+            ProfileEnd(ProfilePhase_Tokenize, tokenize_start_time, worker_index, filename, profile);
+        }
+        
+        u64 parse_start_time = ProfileBegin();
+        PageNodes *nodes = ParseText(context, tokenizer);
+        processed_file.nodes = nodes;
+        processed_file.cold->errors = context->first_error;
+        processed_file.cold->error_count = context->error_count;
+        profile->node_count = nodes->count;
+        ProfileEnd(ProfilePhase_Parse, parse_start_time, worker_index, filename, profile);
+        
+        u64 metadata_start_time = ProfileBegin();
+        
+        // NOTE(rjf): Pull the page's metadata out in one pass. The first of each kind of node
+        // wins. If a PageTitle has not been specified, then the first Title is used.
+        PageNodeID page_title = nodes->count;
+        PageNodeID title = nodes->count;
+        PageNodeID description = nodes->count;
+        PageNodeID date = nodes->count;
+        for(PageNodeID node = 0; node < nodes->count; ++node)
+        {
+            switch(nodes->types[node])
+            {
+                case PageNodeType_PageTitle:   { if(page_title == nodes->count)  { page_title = node;  } break; }
+                case PageNodeType_Title:       { if(title == nodes->count)       { title = node;       } break; }
+                case PageNodeType_Description: { if(description == nodes->count) { description = node; } break; }
+                case PageNodeType_Date:        { if(date == nodes->count)        { date = node;        } break; }
+                default: break;
+            }
+        }
+        
+        if(page_title < nodes->count)
+        {
+            processed_file.main_title = InternedCString(InternString(nodes->strings[page_title].string, nodes->strings[page_title].length));
+        }
+        else if(title < nodes->count)
+        {
+            processed_file.main_title = InternedCString(InternString(nodes->strings[title].string, nodes->strings[title].length));
+        }
+        else if(nodes->count)
+        {
+            processed_file.main_title = "";
+        }
+        
+        if(description < nodes->count)
+        {
+            processed_file.cold->description = ParseContextAllocateCStringCopyN(context, nodes->strings[description].string, nodes->strings[description].length);
+        }
+        
+        if(date < nodes->count)
+        {
+            PageNodeExtra *extra = PageNodeGetExtra(nodes, date);
+            processed_file.date_year = extra->date.year;
+            processed_file.date_month = extra->date.month;
+            processed_file.date_day = extra->date.day;
+        }
+        
+        ProfileEnd(ProfilePhase_Metadata, metadata_start_time, worker_index, filename, profile);
+    }
+    
+    processed_file.url = ParseContextAllocateCStringCopy(context, process_data->filename_no_extension);
+    
+    if(process_data->output_flags & OutputFlag_HTML)
+    {
+        processed_file.cold->html_output_path = ParseContextAllocateCStringCopy(context, process_data->html_output_path);
+        
+        // NOTE(rjf): Listers link to pages relative to the generated folder.
+        processed_file.lister_url = processed_file.cold->html_output_path;
+        for(int i = 0; processed_file.cold->html_output_path[i]; ++i)
+        {
+            if(CStringMatchCaseSensitiveN(processed_file.cold->html_output_path+i, "generated/", 10))
+            {
+                processed_file.lister_url = processed_file.cold->html_output_path+i+10;
+                break;
+            }
+        }
+    }
+    
+    if(process_data->output_flags & OutputFlag_Markdown)
+    {
+        processed_file.cold->markdown_output_path = ParseContextAllocateCStringCopy(context, process_data->md_output_path);
+    }
+    
+    if(process_data->output_flags & OutputFlag_BBCode)
+    {
+        processed_file.cold->bbcode_output_path = ParseContextAllocateCStringCopy(context, process_data->bbcode_output_path);
+    }
+    
+    if(profiler.enabled)
+    {
+        processed_file.cold->profile.arena_bytes = ArenaUsedSize(&context->arena) - arena_used_size;
+    }
+    
+    return processed_file;
+}
+
+typedef struct KeywordPrefixTreeNode KeywordPrefixTreeNode;
+struct KeywordPrefixTreeNode
+{
+    char *prefix;
+    int prefix_length;
+    char *value;
+    int value_length;
+    KeywordPrefixTreeNode *have_child;
+    KeywordPrefixTreeNode *no_have_child;
+};
+
+void
+InsertKeywordIntoTree(KeywordPrefixTreeNode **tree, ParseContext *context, char *key, int key_length, char *value, int value_length)
+{
+    KeywordPrefixTreeNode **node_target = tree;
+    for(KeywordPrefixTreeNode *node = *tree;;)
+    {
+        int matching_key_characters = 0;
+        
+        if(node)
+        {
+            for(int i = 0; i < node->prefix_length && i < key_length; ++i)
+            {
+                if(key[i]  == node->prefix[i])
+                {
+                    ++matching_key_characters;
+                }
+                else
+                {
+                    break;
+                }
+            }
+            
+            // NOTE(rjf): We have matching characters, so this is either the node we want, or we want
+            // to allocate a new node on the "have" child.
+            if(matching_key_characters > 0)
+            {
+                if(node->prefix_length <= 1)
+                {
+                    node = node->have_child;
+                    node_target = &node->have_child;
+                }
+                else
+                {
+                    KeywordPrefixTreeNode *new_node = ParseContextAllocateMemory(context, sizeof(*new_node));
+                    new_node->have_child = node;
+                    new_node->no_have_child = 0;
+                    new_node->prefix = key;
+                    new_node->prefix_length = matching_key_characters;
+                    new_node->value = 0;
+                    new_node->value_length = 0;
+                    *node_target = new_node;
+                    node = new_node->no_have_child;
+                    node_target = &new_node->no_have_child;
+                }
+            }
+            
+            // NOTE(rjf): We don't have any matching characters, so move to the no-have child.
+            else
+            {
+                node = node->no_have_child;
+                node_target = &node->no_have_child;
+            }
+        }
+        else
+        {
+            KeywordPrefixTreeNode *new_node = ParseContextAllocateMemory(context, sizeof(*new_node));
+            new_node->have_child = 0;
+            new_node->no_have_child = 0;
+            new_node->prefix = key;
+            new_node->prefix_length = key_length;
+            new_node->value = value;
+            new_node->value_length = value_length;
+            *node_target = new_node;
+            break;
+        }
+    }
+}
+
+int
+GetKeywordValueFromTree(KeywordPrefixTreeNode *tree, char *keyword, int keyword_length, char **value_ptr)
+{
+    int value_length = 0;
+    
+    for(KeywordPrefixTreeNode *node = tree; node;)
+    {
+        int matching_key_characters = 0;
+        
+        for(int i = 0; i < node->prefix_length && i < keyword_length; ++i)
+        {
+            if(keyword[i] == node->prefix[i])
+            {
+                ++matching_key_characters;
+            }
+            else
+            {
+                break;
+            }
+        }
+        
+        if(matching_key_characters == node->prefix_length)
+        {
+            if(matching_key_characters == keyword_length)
+            {
+                if(value_ptr)
+                {
+                    *value_ptr = node->value;
+                    value_length = node->value_length;
+                    break;
+                }
+            }
+            else
+            {
+                node = node->have_child;
+            }
+        }
+        else
+        {
+            node = node->no_have_child;
+        }
+    }
+    
+    return value_length;
+}
+
+KeywordPrefixTreeNode *
+GenerateKeywordPrefixTreeFromFile(ParseContext *context, char *filename)
+{
+    KeywordPrefixTreeNode *root = 0;
+    
+    char *file = LoadEntireFileAndNullTerminate(filename);
+    
+    for(int i = 0; file[i]; ++i)
+    {
+        char *key = 0;
+        int key_length = 0;
+        char *value = 0;
+        int value_length = 0;
+        if(!CharIsSpace(file[i]))
+        {
+            key = file+i+1;
+            for(; key[key_length] != ':'; ++key_length);
+            value = file+i+key_length+1;
+            for(int j = 0; CharIsSpace(file[i+key_length+j]); ++j, ++value);
+            for(; value[value_length] != '\n'; ++value_length);
+            InsertKeywordIntoTree(&root, context, key, key_length, value, value_length);
+        }
+    }
+    
+    free(file);
+    
+    return root;
+}
+
+//~ NOTE(rjf): Build Manifest
+//
+// The manifest maps each output path to a hash of everything that went into producing it
+// (input contents, header/footer, site info, and for pages with listers, the metadata of
+// every listed page). With --incremental, outputs whose hash matches the manifest from the
+// previous run are left alone.
+
+#define BUILD_MANIFEST_PATH ".generator_manifest"
+#define BUILD_MANIFEST_VERSION_LINE "generator_manifest 1"
+
+typedef struct BuildManifestEntry BuildManifestEntry;
+struct BuildManifestEntry
+{
+    char *path;
+    u64 hash;
+};
+
+typedef struct BuildManifest BuildManifest;
+struct BuildManifest
+{
+    int table_size;
+    BuildManifestEntry *table;
+};
+
+static BuildManifestEntry *
+BuildManifestSlot(BuildManifest *manifest, char *path)
 {
-    InputType input_type;
+    BuildManifestEntry *slot = 0;
+    if(manifest->table_size)
+    {
+        u64 index = HashCString(HASH_BEGIN, path) & (manifest->table_size-1);
+        for(;; index = (index+1) & (manifest->table_size-1))
+        {
+            slot = manifest->table + index;
+            if(!slot->path || CStringMatchCaseInsensitive(slot->path, path))
+            {
+                break;
+            }
+        }
+    }
+    return slot;
+}
+
+static BuildManifest
+LoadBuildManifest(char *filename)
+{
+    BuildManifest manifest = {0};
+    char *file = LoadEntireFileAndNullTerminate(filename);
+    
+    if(file && CStringMatchCaseSensitiveN(file, BUILD_MANIFEST_VERSION_LINE "\n",
+                                          sizeof(BUILD_MANIFEST_VERSION_LINE)))
+    {
+        int line_count = 0;
+        for(int i = 0; file[i]; ++i)
+        {
+            if(file[i] == '\n')
+            {
+                ++line_count;
+            }
+        }
+        
+        manifest.table_size = 16;
+        while(manifest.table_size < line_count*2)
+        {
+            manifest.table_size *= 2;
+        }
+        manifest.table = calloc(manifest.table_size, sizeof(BuildManifestEntry));
+        
+        // NOTE(rjf): Each line after the version line is "<hex hash> <output path>".
+        char *line = file + sizeof(BUILD_MANIFEST_VERSION_LINE);
+        while(*line)
+        {
+            char *line_end = line;
+            for(; *line_end && *line_end != '\n'; ++line_end);
+            int at_end = !*line_end;
+            *line_end = 0;
+            
+            char *path = 0;
+            u64 hash = strtoull(line, &path, 16);
+            if(path && *path == ' ' && path[1])
+            {
+                ++path;
+                BuildManifestEntry *slot = BuildManifestSlot(&manifest, path);
+                slot->path = path;
+                slot->hash = hash;
+            }
+            
+            line = at_end ? line_end : line_end+1;
+        }
+    }
+    else if(file)
+    {
+        free(file);
+    }
+    
+    return manifest;
+}
+
+static int
+BuildManifestOutputIsUpToDate(BuildManifest *manifest, char *path, u64 hash, int gzip)
+{
+    int up_to_date = 0;
+    BuildManifestEntry *slot = BuildManifestSlot(manifest, path);
+    if(slot && slot->path && slot->hash == hash)
+    {
+        // NOTE(rjf): The output still has to exist; somebody may have cleaned generated/.
+        // With --gzip, so does a current .gz sibling.
+        FILE *file = fopen(path, "rb");
+        if(file)
+        {
+            up_to_date = 1;
+            fclose(file);
+        }
+        if(up_to_date && gzip)
+        {
+            up_to_date = GzipSiblingIsCurrent(path);
+        }
+    }
+    return up_to_date;
+}
+
+static void
+WriteBuildManifest(char *filename, ProcessedFile *files, int file_count)
+{
+    char temporary_path[1024] = {0};
+    snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", filename);
+    FILE *file = fopen(temporary_path, "wb");
+    if(file)
+    {
+        fprintf(file, "%s\n", BUILD_MANIFEST_VERSION_LINE);
+        for(int i = 0; i < file_count; ++i)
+        {
+            if(files[i].cold->html_output_path && files[i].cold->html_output_hash)
+            {
+                fprintf(file, "%016llx %s\n", (unsigned long long)files[i].cold->html_output_hash,
+                        files[i].cold->html_output_path);
+            }
+            for(int j = 0; j < files[i].cold->archive_output_count; ++j)
+            {
+                if(files[i].cold->archive_output_hashes[j])
+                {
+                    char path[1024] = {0};
+                    ListerView view = ListerViewForOutput(0, files+i, j+1);
+                    if(FormatListerOutputPath(files[i].cold->html_output_path, &view, path, sizeof(path)))
+                    {
+                        fprintf(file, "%016llx %s\n", (unsigned long long)files[i].cold->archive_output_hashes[j], path);
+                    }
+                }
+            }
+        }
+        int success = !ferror(file);
+        success = (fclose(file) == 0) && success;
+        if(!success || !RenameFileReplacing(temporary_path, filename))
+        {
+            fprintf(stderr, "ERROR: Could not write build manifest \"%s\".\n", filename);
+            remove(temporary_path);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Could not write build manifest \"%s\".\n", filename);
+    }
+}
+
+static u64
+HashSiteInfo(SiteInfo *site_info, OutputFlags output_flags, char *html_header, char *html_footer)
+{
+    u64 hash = HASH_BEGIN;
+    
+    // NOTE(rjf): A rebuilt generator may emit differently, so it invalidates everything.
+    hash = HashCString(hash, __DATE__ " " __TIME__);
+    hash = HashU64(hash, output_flags);
+    hash = HashCString(hash, html_header);
+    hash = HashCString(hash, html_footer);
+    hash = HashCString(hash, site_info->canonical_url);
+    hash = HashCString(hash, site_info->main_title);
+    hash = HashCString(hash, site_info->author);
+    hash = HashCString(hash, site_info->twitter_handle);
+    hash = HashCString(hash, site_info->icon_path);
+    hash = HashBytes(hash, site_info->critical_css, site_info->critical_css_size);
+    return hash;
+}
+
+static u64
+HashListerDependencies(u64 hash, PageNodes *nodes, ListerIndex *listers)
+{
+    // NOTE(rjf): This has to cover exactly what PageNodeType_Lister emits, in the same order.
+    for(PageNodeID node = 0; nodes && node < nodes->count; ++node)
+    {
+        if(nodes->types[node] == PageNodeType_Lister)
+        {
+            ListerIndexEntry *lister = ListerIndexLookUp(listers, PageNodeGetExtra(nodes, node)->lister.prefix);
+            for(int i = 0; lister && i < lister->result_count; ++i)
+            {
+                ProcessedFile *file = listers->files + listers->results[lister->first_result + i];
+                hash = HashCString(hash, file->lister_url);
+                hash = HashCString(hash, file->main_title);
+                hash = HashU64(hash, file->date_year);
+                hash = HashU64(hash, file->date_month);
+                hash = HashU64(hash, file->date_day);
+            }
+        }
+    }
+    return hash;
+}
+
+typedef struct SiteBuild SiteBuild;
+struct SiteBuild
+{
+    SiteInfo *site_info;
     OutputFlags output_flags;
-    char *filename_no_extension;
-    char *html_output_path;
-    char *md_output_path;
-    char *bbcode_output_path;
     char *html_header;
     char *html_footer;
+    char **input_filenames;
+    int file_count;
+    int file_capacity;
+    ProcessedFile *files;
+    ListerIndex listers;
+    ParseContext *worker_contexts;
+    OutputBuffer *worker_output_buffers;
+    
+    // NOTE(rjf): Incremental Builds
+    int incremental;
+    u64 site_hash;
+    BuildManifest manifest;
+    volatile i32 output_count;
+    volatile i32 up_to_date_output_count;
+    volatile i32 unchanged_output_count;
 };
 
-typedef struct ProcessedFile ProcessedFile;
-struct ProcessedFile
+static void
+AddInputFile(SiteBuild *build, char *filename)
 {
-    // NOTE(rjf): Page Content Format Root
-    PageNode *root;
-    char *html_file_contents;
+    if(build->file_count >= build->file_capacity)
+    {
+        build->file_capacity = build->file_capacity ? build->file_capacity*2 : 256;
+        build->input_filenames = realloc(build->input_filenames, sizeof(char *)*build->file_capacity);
+        build->files = realloc(build->files, sizeof(ProcessedFile)*build->file_capacity);
+    }
+    build->input_filenames[build->file_count] = filename;
+    MemorySet(build->files + build->file_count, 0, sizeof(ProcessedFile));
+    ++build->file_count;
+}
+
+static ProcessedFile
+LoadAndProcessFile(SiteBuild *build, char *filename, ParseContext *context, int worker_index)
+{
+    Log("Processing file \"%s\".", filename);
     
-    // NOTE(rjf): File Data
-    char *filename;
-    char *main_title;
-    char *description;
-    char *url;
+    char extension[256] = {0};
+    char filename_no_extension[256] = {0};
+    char html_output_path[512] = {0};
+    char md_output_path[512] = {0};
+    char bbcode_output_path[512] = {0};
     
-    // NOTE(rjf): Date
-    int date_year;
-    int date_month;
-    int date_day;
+    snprintf(filename_no_extension, sizeof(filename_no_extension), "%s", filename);
+    char *last_period = filename_no_extension;
+    for(int i = 0; filename_no_extension[i]; ++i)
+    {
+        if(filename_no_extension[i] == '.')
+        {
+            last_period = filename_no_extension+i;
+        }
+    }
+    *last_period = 0;
     
-    // NOTE(rjf): General Input/Output Data
-    InputType input_type;
-    OutputFlags output_flags;
+    snprintf(html_output_path, sizeof(html_output_path), "generated/%s.html", filename_no_extension);
+    snprintf(md_output_path, sizeof(md_output_path), "generated/%s.md", filename_no_extension);
+    snprintf(bbcode_output_path, sizeof(bbcode_output_path), "generated/%s.bbcode", filename_no_extension);
     
-    // NOTE(rjf): HTML Output
-    char *html_header;
-    char *html_footer;
-    char *html_output_path;
-    FILE *html_output_file;
+    snprintf(extension, sizeof(extension), "%s", last_period+1);
+    InputType input_type = InputType_RXW;
+    if(CStringMatchCaseInsensitive(extension, "html"))
+    {
+        input_type = InputType_HTML;
+    }
     
-    // NOTE(rjf): Other Formats (TODO)
-    char *markdown_output_path;
-    FILE *markdown_output_file;
-    char *bbcode_output_path;
-    FILE *bbcode_output_file;
-};
+    u64 load_start_time = ProfileBegin();
+    FileData source_file = {0};
+    u64 content_hash = 0;
+    u64 input_size = 0;
+    int input_missing = 0;
+    if(input_type == InputType_HTML)
+    {
+        input_missing = !HashFileContents(filename, &content_hash, &input_size);
+    }
+    else
+    {
+        source_file = LoadFileData(filename);
+        input_missing = !source_file.data;
+        if(source_file.data)
+        {
+            content_hash = HashBytes(HASH_BEGIN, source_file.data, source_file.size);
+            input_size = source_file.size;
+        }
+    }
+    u64 load_time = ProfileEnd(ProfilePhase_Load, load_start_time, worker_index, filename, 0);
+    
+    if(input_missing)
+    {
+        fprintf(stderr, "ERROR: Could not load \"%s\".\n", filename);
+    }
+    
+    FileProcessData process_data = {0};
+    {
+        process_data.input_type = input_type;
+        process_data.output_flags = build->output_flags;
+        process_data.filename_no_extension = filename_no_extension;
+        process_data.html_output_path = html_output_path;
+        process_data.md_output_path = md_output_path;
+        process_data.bbcode_output_path = bbcode_output_path;
+        process_data.html_header = build->html_header;
+        process_data.html_footer = build->html_footer;
+        process_data.worker_index = worker_index;
+    }
+    
+    ProcessedFile processed_file = ProcessFile(filename, source_file.data, &process_data, context);
+    processed_file.cold->source_file = source_file;
+    processed_file.input_missing = input_missing;
+    processed_file.cold->content_hash = content_hash;
+    processed_file.cold->profile.phase_time[ProfilePhase_Load] = load_time;
+    processed_file.cold->profile.bytes_in = input_size;
+    return processed_file;
+}
+
+static JOB_PROC(ProcessInputFileJob)
+{
+    SiteBuild *build = user_data;
+    ParseContext *context = build->worker_contexts + worker_index;
+    build->files[job_index] = LoadAndProcessFile(build, build->input_filenames[job_index], context, worker_index);
+}
+
+typedef enum WriteResult
+{
+    WriteResult_Failed,
+    WriteResult_Written,
+    WriteResult_Unchanged,
+}
+WriteResult;
+
+// NOTE(rjf): Writes the buffer to path, with the contents of inserted_filename (if any)
+// spliced in at insert_offset. If the file on disk already holds exactly those bytes, it is
+// left alone, modification time and all, so that upload and sync tools can skip it. Otherwise
+// the page is written to a temporary file and renamed over the old one, so nothing ever sees
+// a partly written page. Only one file is open at a time per worker.
+//
+// With gzip set, a .gz sibling is written alongside any page that changed, or whose .gz is
+// missing or stale.
+static WriteResult
+WriteOutputFile(char *path, OutputBuffer *buffer, u64 insert_offset, char *inserted_filename, int gzip)
+{
+    WriteResult result = WriteResult_Failed;
+    
+    u64 hash = HashBytes(HASH_BEGIN, buffer->data, insert_offset);
+    u64 size = insert_offset;
+    int inserted_file_readable = 1;
+    if(inserted_filename)
+    {
+        inserted_file_readable = HashFileContentsInto(inserted_filename, &hash, &size);
+    }
+    hash = HashBytes(hash, buffer->data + insert_offset, buffer->size - insert_offset);
+    size += buffer->size - insert_offset;
+    
+    // NOTE(rjf): Only files of the right size get read back.
+    FileInfo existing = GetFileInfo(path);
+    u64 existing_hash = 0;
+    u64 existing_size = 0;
+    if(!inserted_file_readable)
+    {
+        // NOTE(rjf): The existing page is better than one missing its body.
+        fprintf(stderr, "ERROR: Could not read \"%s\"; not writing \"%s\".\n", inserted_filename, path);
+    }
+    else if(existing.exists && existing.size == size &&
+            HashFileContents(path, &existing_hash, &existing_size) && existing_hash == hash)
+    {
+        result = WriteResult_Unchanged;
+    }
+    else
+    {
+        char temporary_path[1024] = {0};
+        snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+        FILE *output_file = fopen(temporary_path, "wb");
+        if(output_file)
+        {
+            int success = (fwrite(buffer->data, 1, insert_offset, output_file) == insert_offset);
+            if(success && inserted_filename && !AppendFileToStream(output_file, inserted_filename))
+            {
+                fprintf(stderr, "ERROR: Could not copy \"%s\" into \"%s\".\n", inserted_filename, path);
+                success = 0;
+            }
+            success = success && (fwrite(buffer->data + insert_offset, 1, buffer->size - insert_offset, output_file) ==
+                                  buffer->size - insert_offset);
+            success = (fclose(output_file) == 0) && success;
+            if(success && RenameFileReplacing(temporary_path, path))
+            {
+                result = WriteResult_Written;
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Could not write \"%s\".\n", path);
+                remove(temporary_path);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Could not open \"%s\" for writing.\n", temporary_path);
+        }
+    }
+    
+    if(gzip && result != WriteResult_Failed)
+    {
+        if(result == WriteResult_Written || !GzipSiblingIsCurrent(path))
+        {
+            // NOTE(rjf): Pages with a spliced-in input are only complete on disk.
+            if(inserted_filename)
+            {
+                FileData page = LoadFileData(path);
+                WriteGzipSibling(path, (u8 *)page.data, page.size);
+                FreeFileData(&page);
+            }
+            else
+            {
+                WriteGzipSibling(path, (u8 *)buffer->data, buffer->size);
+            }
+        }
+    }
+    
+    return result;
+}
+
+static void
+OutputHTMLPage(SiteBuild *build, ProcessedFile *file, ListerView *listers, char *path,
+               u64 output_hash, u64 *last_output_hash, int worker_index)
+{
+    AtomicIncrementI32(&build->output_count);
+    
+    // NOTE(rjf): If we've already written this page during this run (in --watch mode), that
+    // is what we compare against. Otherwise, we go by the last build's manifest.
+    int up_to_date = 0;
+    if(*last_output_hash)
+    {
+        up_to_date = (*last_output_hash == output_hash);
+    }
+    else if(build->incremental)
+    {
+        up_to_date = BuildManifestOutputIsUpToDate(&build->manifest, path, output_hash,
+                                                   !!(build->output_flags & OutputFlag_Gzip));
+    }
+    
+    if(up_to_date)
+    {
+        *last_output_hash = output_hash;
+        AtomicIncrementI32(&build->up_to_date_output_count);
+    }
+    else
+    {
+        OutputBuffer *buffer = build->worker_output_buffers + worker_index;
+        buffer->size = 0;
+        FileProfile *profile = &file->cold->profile;
+        
+        // NOTE(rjf): HTML inputs are spliced in between the header and footer at write time,
+        // unless we're minifying, in which case they have to go through the minifier too.
+        u64 emit_start_time = ProfileBegin();
+        HTMLMinifier minifier = {0};
+        if(build->output_flags & OutputFlag_Minify)
+        {
+            buffer->minifier = &minifier;
+        }
+        OutputHTMLHeader(build->site_info, file, buffer);
+        if(file->nodes)
+        {
+            OutputHTMLFromPageNodes(file->nodes, buffer, listers);
+        }
+        u64 insert_offset = buffer->size;
+        char *inserted_filename = 0;
+        if(file->input_type == InputType_HTML && !file->input_missing)
+        {
+            if(buffer->minifier)
+            {
+                FileData input = LoadFileData(file->filename);
+                OutputBufferAppendStringN(buffer, input.data, input.size);
+                FreeFileData(&input);
+                insert_offset = buffer->size;
+            }
+            else
+            {
+                inserted_filename = file->filename;
+            }
+        }
+        OutputHTMLFooter(file, buffer);
+        buffer->minifier = 0;
+        ProfileEnd(ProfilePhase_Emit, emit_start_time, worker_index, file->filename, profile);
+        
+        u64 write_start_time = ProfileBegin();
+        WriteResult result = WriteOutputFile(path, buffer, insert_offset, inserted_filename,
+                                             !!(build->output_flags & OutputFlag_Gzip));
+        if(result != WriteResult_Failed)
+        {
+            *last_output_hash = output_hash;
+        }
+        if(result == WriteResult_Unchanged)
+        {
+            AtomicIncrementI32(&build->unchanged_output_count);
+        }
+        if(profiler.enabled)
+        {
+            profile->bytes_out += buffer->size + (inserted_filename ? GetFileInfo(inserted_filename).size : 0);
+        }
+        ProfileEnd(ProfilePhase_Write, write_start_time, worker_index, file->filename, profile);
+    }
+}
+
+static JOB_PROC(OutputFileJob)
+{
+    SiteBuild *build = user_data;
+    ProcessedFile *file = build->files + job_index;
+    
+    if(file->output_flags & OutputFlag_HTML)
+    {
+        u64 output_hash = HashU64(build->site_hash, file->cold->content_hash);
+        output_hash = HashCString(output_hash, file->cold->html_output_path);
+        output_hash = HashListerDependencies(output_hash, file->nodes, &build->listers);
+        
+        // NOTE(rjf): Pages with paginated listers have more than one output.
+        int output_count = ListerOutputCount(file);
+        if(file->cold->archive_output_count != output_count-1)
+        {
+            free(file->cold->archive_output_hashes);
+            file->cold->archive_output_count = output_count-1;
+            file->cold->archive_output_hashes = output_count > 1 ? calloc(output_count-1, sizeof(u64)) : 0;
+        }
+        
+        for(int i = 0; i < output_count; ++i)
+        {
+            ListerView view = ListerViewForOutput(&build->listers, file, i);
+            if(i == 0)
+            {
+                OutputHTMLPage(build, file, &view, file->cold->html_output_path, output_hash,
+                               &file->cold->html_output_hash, worker_index);
+            }
+            else
+            {
+                char path[1024] = {0};
+                if(!FormatListerOutputPath(file->cold->html_output_path, &view, path, sizeof(path)))
+                {
+                    fprintf(stderr, "ERROR: Archive path for \"%s\" is too long, not writing it.\n",
+                            file->cold->html_output_path);
+                    continue;
+                }
+                if(ListerOutputIsShadowed(&build->listers, &view))
+                {
+                    fprintf(stderr, "ERROR: Archive page \"%s\" of \"%s\" would overwrite the page of the "
+                            "same name, not writing it.\n", path, file->filename);
+                    continue;
+                }
+                u64 archive_hash = HashU64(HashU64(output_hash, view.page_number), view.year);
+                OutputHTMLPage(build, file, &view, path, archive_hash,
+                               file->cold->archive_output_hashes + i-1, worker_index);
+            }
+        }
+    }
+    
+    if(file->output_flags & OutputFlag_Markdown)
+    {
+        file->cold->markdown_output_file = fopen(file->cold->markdown_output_path, "wb");
+    }
+    
+    if(file->output_flags & OutputFlag_BBCode)
+    {
+        file->cold->bbcode_output_file = fopen(file->cold->bbcode_output_path, "wb");
+    }
+    
+    if(file->cold->markdown_output_file)
+    {
+        // TODO(rjf)
+        fclose(file->cold->markdown_output_file);
+        file->cold->markdown_output_file = 0;
+    }
+    
+    if(file->cold->bbcode_output_file)
+    {
+        // TODO(rjf)
+        fclose(file->cold->bbcode_output_file);
+        file->cold->bbcode_output_file = 0;
+    }
+}
+
+static void
+PrintParseErrors(ProcessedFile *file)
+{
+    for(ParseError *error = file->cold->errors; error; error = error->next)
+    {
+        fprintf(stderr, "Parse Error (%s:%i): %s\n", error->file, error->line, error->message);
+    }
+}
+
+//~ NOTE(rjf): Profile Reports
+
+#define PROFILE_SLOWEST_FILE_COUNT 10
+
+static u64
+FileProfileTotalTime(FileProfile *profile)
+{
+    u64 total_time = 0;
+    for(int i = 0; i < ProfilePhase_COUNT; ++i)
+    {
+        total_time += profile->phase_time[i];
+    }
+    return total_time;
+}
 
 static int
-ProcessedFileSortFunction(const void *file1_, const void *file2_)
+ProfiledFileSortFunction(const void *a_, const void *b_)
 {
-    int result = 0;
+    ProcessedFile *a = *(ProcessedFile **)a_;
+    ProcessedFile *b = *(ProcessedFile **)b_;
+    u64 a_time = FileProfileTotalTime(&a->cold->profile);
+    u64 b_time = FileProfileTotalTime(&b->cold->profile);
+    return a_time < b_time ? 1 : a_time > b_time ? -1 : 0;
+}
+
+static void
+PrintProfileSummary(ProcessedFile *files, int file_count)
+{
+    u64 wall_time = GetTimeMicroseconds() - profiler.start_time;
     
-    const ProcessedFile *file1 = file1_;
-    const ProcessedFile *file2 = file2_;
+    u64 phase_time[ProfilePhase_COUNT] = {0};
+    u64 phase_max_time[ProfilePhase_COUNT] = {0};
+    int phase_zone_count[ProfilePhase_COUNT] = {0};
+    for(int i = 0; i < profiler.worker_count; ++i)
+    {
+        ProfileWorker *worker = profiler.workers + i;
+        for(int j = 0; j < worker->zone_count; ++j)
+        {
+            ProfileZone *zone = worker->zones + j;
+            u64 duration = zone->end_time - zone->start_time;
+            phase_time[zone->phase] += duration;
+            phase_zone_count[zone->phase] += 1;
+            if(phase_max_time[zone->phase] < duration)
+            {
+                phase_max_time[zone->phase] = duration;
+            }
+        }
+    }
     
-    if(file1->date_year < file2->date_year)
+    Log("Profile: %.2f ms wall time, %i worker(s). Phase times are summed across workers.",
+        wall_time / 1000.0, profiler.worker_count);
+    Log("  %-10s %12s %8s %10s %10s", "phase", "total ms", "zones", "mean us", "max us");
+    for(int i = 0; i < ProfilePhase_COUNT; ++i)
     {
-        result = 1;
+        Log("  %-10s %12.2f %8i %10.1f %10llu", profile_phase_names[i], phase_time[i] / 1000.0,
+            phase_zone_count[i], phase_zone_count[i] ? (double)phase_time[i] / phase_zone_count[i] : 0.0,
+            (unsigned long long)phase_max_time[i]);
     }
-    else if(file1->date_year == file2->date_year)
+    
+    FileProfile totals = {0};
+    ProcessedFile **sorted_files = malloc(sizeof(ProcessedFile *)*file_count);
+    for(int i = 0; i < file_count; ++i)
     {
-        if(file1->date_month < file2->date_month)
+        FileProfile *profile = &files[i].cold->profile;
+        totals.bytes_in += profile->bytes_in;
+        totals.bytes_out += profile->bytes_out;
+        totals.token_count += profile->token_count;
+        totals.node_count += profile->node_count;
+        totals.arena_bytes += profile->arena_bytes;
+        sorted_files[i] = files+i;
+    }
+    Log("  %.2f MB in, %.2f MB out, %llu tokens, %llu nodes, %.2f MB of parse arenas.",
+        totals.bytes_in / (1024.0*1024.0), totals.bytes_out / (1024.0*1024.0),
+        (unsigned long long)totals.token_count, (unsigned long long)totals.node_count,
+        totals.arena_bytes / (1024.0*1024.0));
+    
+    QuickSort(sorted_files, file_count, sizeof(ProcessedFile *), ProfiledFileSortFunction);
+    Log("  Slowest files:");
+    Log("  %10s %10s %10s %10s %10s %10s %10s %10s  %s", "total ms", "load", "tokenize", "parse", "emit", "write",
+        "KB in", "KB out", "file");
+    for(int i = 0; i < file_count && i < PROFILE_SLOWEST_FILE_COUNT; ++i)
+    {
+        FileProfile *profile = &sorted_files[i]->cold->profile;
+        Log("  %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.1f %10.1f  %s",
+            FileProfileTotalTime(profile) / 1000.0,
+            profile->phase_time[ProfilePhase_Load] / 1000.0,
+            profile->phase_time[ProfilePhase_Tokenize] / 1000.0,
+            profile->phase_time[ProfilePhase_Parse] / 1000.0,
+            profile->phase_time[ProfilePhase_Emit] / 1000.0,
+            profile->phase_time[ProfilePhase_Write] / 1000.0,
+            profile->bytes_in / 1024.0, profile->bytes_out / 1024.0, sorted_files[i]->filename);
+    }
+    free(sorted_files);
+}
+
+static void
+WriteJSONString(FILE *file, char *string)
+{
+    fputc('"', file);
+    for(char *at = string; at && *at; ++at)
+    {
+        unsigned char c = (unsigned char)*at;
+        if(c == '"' || c == '\\')
         {
-            result = 1;
+            fprintf(file, "\\%c", c);
         }
-        else if(file1->date_month == file2->date_month)
+        else if(c < 32)
         {
-            if(file1->date_day < file2->date_day)
+            fprintf(file, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+// NOTE(rjf): Chrome's trace-event format: one complete ("X") event per zone, with times in
+// microseconds since the build started, and one thread per worker.
+static int
+WriteProfileTrace(char *path)
+{
+    int success = 0;
+    FILE *file = fopen(path, "wb");
+    if(file)
+    {
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        int first_event = 1;
+        for(int i = 0; i < profiler.worker_count; ++i)
+        {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"worker %i\"}}",
+                    first_event ? "" : ",\n", i, i);
+            first_event = 0;
+            
+            ProfileWorker *worker = profiler.workers + i;
+            for(int j = 0; j < worker->zone_count; ++j)
             {
-                result = 1;
+                ProfileZone *zone = worker->zones + j;
+                fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"generator\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%llu,\"dur\":%llu",
+                        profile_phase_names[zone->phase], i,
+                        (unsigned long long)(zone->start_time - profiler.start_time),
+                        (unsigned long long)(zone->end_time - zone->start_time));
+                if(zone->filename)
+                {
+                    fprintf(file, ",\"args\":{\"file\":");
+                    WriteJSONString(file, zone->filename);
+                    fprintf(file, "}");
+                }
+                fprintf(file, "}");
             }
-            else if(file1->date_day == file2->date_day)
+        }
+        fprintf(file, "\n]}\n");
+        success = !ferror(file);
+        fclose(file);
+    }
+    return success;
+}
+
+//~ NOTE(rjf): CSS and JS Minification
+//
+// With --minify, .css and .js assets are minified instead of copied. Both minifiers work on
+// tokens, so strings (and in JS, regular expressions and template literals) are never
+// touched, and both only remove whitespace and comments where that can't change meaning.
+//
+// Stylesheets also lose the rules that can't match anything we publish. A selector is
+// dropped when it names a class or id that appears in none of the places markup can come
+// from: the emitter (html_page_node_names), the header and footer templates, raw HTML
+// inputs, and scripts (which add classes like "hidden" at runtime). Those are scanned for
+// every word that could be a name. That over-counts, which only ever keeps a rule that could
+// have gone, never the other way around. Anything with a functional pseudo-class like :not()
+// is always kept.
+//
+// The same pruning, with element names checked too, picks out the critical CSS inlined into
+// each page (see Critical CSS).
+
+typedef struct NameSet NameSet;
+struct NameSet
+{
+    u64 *hashes;
+    u32 count;
+    u32 capacity;
+};
+
+static int
+CharIsNameChar(char c)
+{
+    return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+            c == '_' || c == '-' || (u8)c >= 0x80);
+}
+
+// NOTE(rjf): Names are kept as hashes in an open-addressed table; 0 marks an empty slot.
+static void
+NameSetInsert(NameSet *set, char *name, u64 length)
+{
+    if(2*(set->count+1) > set->capacity)
+    {
+        NameSet grown = {0};
+        grown.capacity = set->capacity ? set->capacity*2 : 1024;
+        grown.hashes = calloc(grown.capacity, sizeof(u64));
+        for(u32 i = 0; i < set->capacity; ++i)
+        {
+            if(set->hashes[i])
             {
-                result = 0;
+                u32 slot = (u32)set->hashes[i] & (grown.capacity-1);
+                while(grown.hashes[slot])
+                {
+                    slot = (slot+1) & (grown.capacity-1);
+                }
+                grown.hashes[slot] = set->hashes[i];
+                grown.count += 1;
             }
-            else if(file1->date_day > file2->date_day)
+        }
+        free(set->hashes);
+        *set = grown;
+    }
+
+    u64 hash = HashBytes(HASH_BEGIN, name, length) | 1;
+    u32 slot = (u32)hash & (set->capacity-1);
+    while(set->hashes[slot] && set->hashes[slot] != hash)
+    {
+        slot = (slot+1) & (set->capacity-1);
+    }
+    if(!set->hashes[slot])
+    {
+        set->hashes[slot] = hash;
+        set->count += 1;
+    }
+}
+
+static int
+NameSetContains(NameSet *set, char *name, u64 length)
+{
+    int found = 0;
+    if(set->capacity)
+    {
+        u64 hash = HashBytes(HASH_BEGIN, name, length) | 1;
+        u32 slot = (u32)hash & (set->capacity-1);
+        while(set->hashes[slot])
+        {
+            if(set->hashes[slot] == hash)
             {
-                result = -1;
+                found = 1;
+                break;
             }
+            slot = (slot+1) & (set->capacity-1);
         }
-        else if(file1->date_month > file2->date_month)
+    }
+    return found;
+}
+
+static void
+NameSetInsertWords(NameSet *set, char *text, u64 size)
+{
+    for(u64 i = 0; i < size;)
+    {
+        if(CharIsNameChar(text[i]))
         {
-            result = -1;
+            u64 start = i;
+            while(i < size && CharIsNameChar(text[i]))
+            {
+                ++i;
+            }
+            NameSetInsert(set, text + start, i - start);
+        }
+        else
+        {
+            ++i;
         }
     }
-    else if(file1->date_year > file2->date_year)
+}
+
+// NOTE(rjf): Copies a quoted string (or JS regular expression or template literal) starting
+// at text[i], and returns the index just past it.
+static u64
+CopyQuotedRun(char *text, u64 size, u64 i, char terminator, OutputBuffer *out)
+{
+    u64 start = i++;
+    int in_class = 0;
+    for(; i < size; ++i)
     {
-        result = -1;
+        if(text[i] == '\\')
+        {
+            ++i;
+        }
+        else if(terminator == '/' && text[i] == '[')
+        {
+            in_class = 1;
+        }
+        else if(terminator == '/' && text[i] == ']')
+        {
+            in_class = 0;
+        }
+        else if(text[i] == terminator && !in_class)
+        {
+            ++i;
+            break;
+        }
     }
-    
-    return result;
+    if(i > size)
+    {
+        i = size;
+    }
+    OutputBufferWriteN(out, text + start, i - start);
+    return i;
 }
 
-static void
-OutputHTMLFromPageNodeTreeToFile_(PageNode *node, FILE *file, int follow_next, ProcessedFile *files, int file_count)
+typedef enum CSSBlockType
 {
-    int paragraph_active = 0;
-    int thumbnails_active = 0;
-    int found_Title = 0;
-    
-    PageNode *date = 0;
-    for(date = node; date; date = date->next)
+    CSSBlockType_Rules,
+    CSSBlockType_Declarations,
+}
+CSSBlockType;
+
+// NOTE(rjf): Whether whitespace between two characters can go. It always can around braces,
+// ';' and ',', after '(' and before ')'. In selectors it also can around combinators, but not
+// before ':' ("a :hover" and "a:hover" differ); in declarations it can around ':' and before
+// '!', but not around '+' and the like, which might be arithmetic in calc(). It never can
+// before '(' ("and (" in a media query is not "and(").
+static int
+CSSSpaceIsDroppable(char before, char after, CSSBlockType context)
+{
+    int droppable = (before == '{' || before == '}' || before == ';' || before == ',' || before == '(' ||
+                     after == '{' || after == '}' || after == ';' || after == ',' || after == ')');
+    if(context == CSSBlockType_Declarations)
     {
-        if(date->type == PageNodeType_Date)
+        droppable = droppable || before == ':' || after == ':' || after == '!';
+    }
+    else
+    {
+        droppable = (droppable || before == '>' || before == '+' || before == '~' ||
+                     after == '>' || after == '+' || after == '~');
+    }
+    return droppable;
+}
+
+// NOTE(rjf): At-rules whose blocks hold rules rather than declarations. The conditional ones
+// are pruned like the top level; keyframes are kept whole.
+static char *css_conditional_group_rules[] = { "@media", "@supports", "@document", "@layer", "@container" };
+static char *css_keyframes_rules[] = { "@keyframes", "@-webkit-keyframes", "@-moz-keyframes" };
+
+static int
+CSSPreludeMatchesAny(char *prelude, u64 length, char **names, int name_count)
+{
+    int matches = 0;
+    for(int i = 0; i < name_count; ++i)
+    {
+        u64 name_length = CalculateCStringLength(names[i]);
+        if(length >= name_length && CStringMatchCaseSensitiveN(prelude, names[i], (int)name_length))
         {
+            matches = 1;
             break;
         }
     }
-    
-    static char *month_names[] =
-    {
-        "January",
-        "February",
-        "March",
-        "April",
-        "May",
-        "June",
-        "July",
-        "August",
-        "September",
-        "October",
-        "November",
-        "December",
-    };
-    
-    PageNode *previous_node = 0;
-    
-    for(; node; previous_node = node, node = node->next)
+    return matches;
+}
+
+static int
+CSSPreludeIsConditionalGroup(char *prelude, u64 length)
+{
+    return CSSPreludeMatchesAny(prelude, length, css_conditional_group_rules,
+                                (int)(sizeof(css_conditional_group_rules)/sizeof(css_conditional_group_rules[0])));
+}
+
+static int
+CSSPreludeIsKeyframes(char *prelude, u64 length)
+{
+    return CSSPreludeMatchesAny(prelude, length, css_keyframes_rules,
+                                (int)(sizeof(css_keyframes_rules)/sizeof(css_keyframes_rules[0])));
+}
+
+// NOTE(rjf): Strips comments and needless whitespace, and the last ';' of each block.
+static void
+MinifyCSSWhitespace(char *css, u64 size, OutputBuffer *out)
+{
+    CSSBlockType block_stack[64];
+    int depth = 0;
+    CSSBlockType context = CSSBlockType_Rules;
+    u64 prelude_start = out->size;
+    int pending_space = 0;
+
+    for(u64 i = 0; i < size;)
     {
-        switch(node->type)
+        char c = css[i];
+        if(c == '/' && i+1 < size && css[i+1] == '*')
         {
-            case PageNodeType_Title:
+            for(i += 2; i < size && !(css[i] == '*' && i+1 < size && css[i+1] == '/'); ++i);
+            i += 2;
+            continue;
+        }
+        if(CharIsHTMLSpace(c))
+        {
+            pending_space = 1;
+            ++i;
+            continue;
+        }
+
+        if(pending_space && out->size > prelude_start && !CSSSpaceIsDroppable(out->data[out->size-1], c, context))
+        {
+            OutputBufferWriteN(out, " ", 1);
+        }
+        pending_space = 0;
+
+        if(c == '"' || c == '\'')
+        {
+            i = CopyQuotedRun(css, size, i, c, out);
+            continue;
+        }
+
+        if(c == '{')
+        {
+            char *prelude = out->data + prelude_start;
+            u64 prelude_length = out->size - prelude_start;
+            CSSBlockType type = CSSBlockType_Declarations;
+            if(context == CSSBlockType_Rules &&
+               (CSSPreludeIsConditionalGroup(prelude, prelude_length) || CSSPreludeIsKeyframes(prelude, prelude_length)))
             {
-                fprintf(file, "<h1>%.*s</h1>\n", node->string_length, node->string);
-                
-                if(!found_Title && date)
-                {
-                    found_Title = 1;
-                    fprintf(file, "<h2>%i %s %i</h2>\n",
-                            date->date.day, month_names[date->date.month-1], date->date.year);
-                }
-                
-                break;
+                type = CSSBlockType_Rules;
             }
-            case PageNodeType_SubTitle:
+            if(depth < (int)(sizeof(block_stack)/sizeof(block_stack[0])))
             {
-                if(previous_node && previous_node->type != PageNodeType_Title)
-                {
-                    fprintf(file, "<hr><br>\n");
-                }
-                fprintf(file, "<h2>%.*s</h2>\n", node->string_length, node->string);
-                break;
+                block_stack[depth++] = context;
             }
-            case PageNodeType_Text:
+            context = type;
+        }
+        else if(c == '}')
+        {
+            if(out->size && out->data[out->size-1] == ';')
             {
-                if(!paragraph_active)
-                {
-                    fprintf(file, "<p>");
-                    paragraph_active = 1;
-                }
-                
-                if(node->text_style_flags & TextStyleFlag_Bold)
-                {
-                    fprintf(file, "<strong>");
-                }
-                if(node->text_style_flags & TextStyleFlag_Underline)
-                {
-                    fprintf(file, "<u>");
-                }
-                if(node->text_style_flags & TextStyleFlag_Italics)
-                {
-                    fprintf(file, "<i>");
-                }
-                if(node->text_style_flags & TextStyleFlag_Monospace)
-                {
-                    fprintf(file, "<span class=\"monospace\">");
-                }
-                fprintf(file, "%.*s", node->string_length, node->string);
-                if(node->text_style_flags & TextStyleFlag_Monospace)
-                {
-                    fprintf(file, "</span>");
-                }
-                if(node->text_style_flags & TextStyleFlag_Italics)
-                {
-                    fprintf(file, "</i>");
-                }
-                if(node->text_style_flags & TextStyleFlag_Underline)
-                {
-                    fprintf(file, "</u>");
-                }
-                if(node->text_style_flags & TextStyleFlag_Bold)
-                {
-                    fprintf(file, "</strong>");
-                }
-                
-                if(!node->next || (node->next->type != PageNodeType_Text &&
-                                   node->next->type != PageNodeType_Link))
-                {
-                    fprintf(file, "</p>");
-                    paragraph_active = 0;
-                }
-                
-                break;
+                out->size -= 1;
+            }
+            context = depth ? block_stack[--depth] : CSSBlockType_Rules;
+        }
+
+        OutputBufferWriteN(out, &c, 1);
+        if(c == '{' || c == '}' || c == ';')
+        {
+            prelude_start = out->size;
+        }
+        ++i;
+    }
+}
+
+// NOTE(rjf): Returns the index of the first of the terminators outside strings, parentheses
+// and brackets, or size if there is none.
+static u64
+CSSSkipTo(char *css, u64 size, u64 i, char *terminators)
+{
+    int depth = 0;
+    for(; i < size; ++i)
+    {
+        char c = css[i];
+        if(depth <= 0 && c && strchr(terminators, c))
+        {
+            break;
+        }
+        else if(c == '"' || c == '\'')
+        {
+            for(++i; i < size && css[i] != c; ++i)
+            {
+                i += (css[i] == '\\');
+            }
+        }
+        else if(c == '(' || c == '[')
+        {
+            depth += 1;
+        }
+        else if(c == ')' || c == ']')
+        {
+            depth -= 1;
+        }
+    }
+    return i < size ? i : size;
+}
+
+// NOTE(rjf): Returns the index of the '}' matching the '{' at css[i], or size if there is none.
+static u64
+CSSSkipBlock(char *css, u64 size, u64 i)
+{
+    int depth = 0;
+    for(; i < size; ++i)
+    {
+        i = CSSSkipTo(css, size, i, "{}");
+        if(i >= size)
+        {
+            break;
+        }
+        depth += (css[i] == '{') ? 1 : -1;
+        if(depth == 0)
+        {
+            break;
+        }
+    }
+    return i < size ? i : size;
+}
+
+// NOTE(rjf): With match_elements, element names have to be in used_names too. That's only
+// right when used_names is known to hold every element that can occur.
+static int
+CSSSelectorIsUsed(char *selector, u64 length, NameSet *used_names, int match_elements)
+{
+    int used = 1;
+    for(u64 i = 0; i < length && used; ++i)
+    {
+        char c = selector[i];
+        if(c == '(' || c == '\\')
+        {
+            break;
+        }
+        else if(match_elements && CharIsNameChar(c) && c != '-' && (i == 0 || strchr(" >+~", selector[i-1])))
+        {
+            u64 end = i;
+            while(end < length && CharIsNameChar(selector[end]))
+            {
+                ++end;
             }
-            case PageNodeType_ParagraphBreak:
+            used = NameSetContains(used_names, selector + i, end - i);
+            i = end-1;
+        }
+        else if(c == '[')
+        {
+            // NOTE(rjf): Attribute selectors can hold anything, so they are skipped.
+            i = CSSSkipTo(selector, length, i+1, "]");
+        }
+        else if((c == '.' || c == '#') && i+1 < length && CharIsNameChar(selector[i+1]))
+        {
+            u64 start = i+1;
+            u64 end = start;
+            while(end < length && CharIsNameChar(selector[end]))
             {
-                if(paragraph_active)
-                {
-                    fprintf(file, "</p>");
-                    paragraph_active = 0;
-                }
-                break;
+                ++end;
             }
-            case PageNodeType_UnorderedList:
+            used = NameSetContains(used_names, selector + start, end - start);
+            i = end-1;
+        }
+    }
+    return used;
+}
+
+// NOTE(rjf): Copies one list of rules (a whole stylesheet, or the inside of an @media block)
+// from whitespace-minified CSS, leaving out empty rules and, with used_names, rules whose
+// selectors can't match. Stops at the '}' closing the list, and returns its index.
+static u64
+PruneCSSRules(char *css, u64 size, u64 i, NameSet *used_names, int match_elements, OutputBuffer *out)
+{
+    while(i < size && css[i] != '}')
+    {
+        u64 prelude_start = i;
+        i = CSSSkipTo(css, size, i, "{;}");
+        if(i >= size || css[i] == '}')
+        {
+            OutputBufferWriteN(out, css + prelude_start, i - prelude_start);
+            break;
+        }
+        if(css[i] == ';')
+        {
+            OutputBufferWriteN(out, css + prelude_start, i+1 - prelude_start);
+            i += 1;
+            continue;
+        }
+
+        char *prelude = css + prelude_start;
+        u64 prelude_length = i - prelude_start;
+        u64 block_start = i;
+        u64 block_end = CSSSkipBlock(css, size, block_start);
+        if(block_end >= size)
+        {
+            // NOTE(rjf): Unterminated; kept as it was.
+            OutputBufferWriteN(out, prelude, size - prelude_start);
+            i = size;
+        }
+        else if(CSSPreludeIsConditionalGroup(prelude, prelude_length))
+        {
+            u64 group_start = out->size;
+            OutputBufferWriteN(out, prelude, prelude_length+1);
+            u64 contents_start = out->size;
+            i = PruneCSSRules(css, size, block_start+1, used_names, match_elements, out);
+            if(out->size == contents_start)
             {
-                fprintf(file, "<ul>\n");
-                for(PageNode *list_item = node->unordered_list.first_item;
-                    list_item; list_item = list_item->next)
-                {
-                    fprintf(file, "<li>");
-                    OutputHTMLFromPageNodeTreeToFile_(list_item, file, 0, files, file_count);
-                    fprintf(file, "</li>");
-                }
-                fprintf(file, "</ul>\n");
-                break;
+                out->size = group_start;
             }
-            case PageNodeType_OrderedList:
+            else
             {
-                fprintf(file, "<ol>\n");
-                for(PageNode *list_item = node->unordered_list.first_item;
-                    list_item; list_item = list_item->next)
-                {
-                    fprintf(file, "<li>");
-                    OutputHTMLFromPageNodeTreeToFile_(list_item, file, 0, files, file_count);
-                    fprintf(file, "</li>");
-                }
-                fprintf(file, "</ol>\n");
-                break;
+                OutputBufferWriteN(out, "}", 1);
             }
-            case PageNodeType_Code:
+            i += 1;
+        }
+        else if(prelude[0] == '@')
+        {
+            OutputBufferWriteN(out, prelude, block_end+1 - prelude_start);
+            i = block_end+1;
+        }
+        else
+        {
+            u64 rule_start = out->size;
+            if(block_end > block_start+1)
             {
-                fprintf(file, "<div class=\"code\"><pre>");
-                
-                enum
-                {
-                    CODE_TYPE_default,
-                    CODE_TYPE_line_comment,
-                    CODE_TYPE_block_comment,
-                    CODE_TYPE_keyword,
-                    CODE_TYPE_constant,
-                    CODE_TYPE_Tag,
-                };
-                
-                int code_type = CODE_TYPE_default;
-                
-                for(int i = 0; i < node->string_length;)
+                for(u64 selector_start = 0; selector_start < prelude_length;)
                 {
-                    int token_length = 1;
-                    
-                    code_type = CODE_TYPE_default;
-                    
-                    if(node->string[i] == '/' && node->string[i+1] == '/')
-                    {
-                        code_type = CODE_TYPE_line_comment;
-                        for(;
-                            node->string[i+token_length] &&
-                            node->string[i+token_length] != '\n';
-                            ++token_length);
-                        fprintf(file, "<span class=\"code_text\" style=\"color: #8cba53;\">");
-                    }
-                    else if(node->string[i] == '/' && node->string[i+1] == '*')
-                    {
-                        code_type = CODE_TYPE_block_comment;
-                        int nest_level = 1;
-                        for(; node->string[i+token_length]; ++token_length)
-                        {
-                            if(node->string[i+token_length] == '*' &&
-                               node->string[i+token_length+1] == '/')
-                            {
-                                nest_level -= 1;
-                                if(nest_level <= 0)
-                                {
-                                    break;
-                                }
-                            }
-                            else if(node->string[i+token_length] == '/' &&
-                                    node->string[i+token_length+1] == '*')
-                            {
-                                nest_level += 1;
-                            }
-                        }
-                        token_length += 2;
-                        fprintf(file, "<span class=\"code_text\" style=\"color: #8cba53;\">");
-                    }
-                    else if(CharIsAlpha(node->string[i]) || node->string[i] == '_')
-                    {
-                        for(;
-                            node->string[i+token_length] &&
-                            (node->string[i+token_length] == '_' ||
-                             CharIsAlpha(node->string[i+token_length]) ||
-                             CharIsDigit(node->string[i+token_length]));
-                            ++token_length);
-                        
-                        static char *keywords[] =
-                        {
-                            "auto", "break", "case", "char",
-                            "const", "continue", "default", "do", "double",
-                            "else", "enum", "extern", "float",
-                            "for", "goto", "if", "int", "long", "register", "return",
-                            "short", "signed", "sizeof", "static",
-                            "struct", "switch", "typedef", "union", "unsigned",
-                            "void", "volatile", "while",
-                        };
-                        
-                        for(int k = 0; k < sizeof(keywords)/sizeof(keywords[0]); ++k)
-                        {
-                            if(CStringMatchCaseSensitiveN(node->string+i, keywords[k], token_length) &&
-                               token_length == CalculateCStringLength(keywords[k]))
-                            {
-                                code_type = CODE_TYPE_keyword;
-                                fprintf(file, "<span class=\"code_text\" style=\"color: #f4b642;\">");
-                                break;
-                            }
-                        }
-                    }
-                    else if(CharIsDigit(node->string[i]))
-                    {
-                        for(;
-                            node->string[i+token_length] &&
-                            (node->string[i+token_length] == '.' ||
-                             CharIsAlpha(node->string[i+token_length]) ||
-                             CharIsDigit(node->string[i+token_length]));
-                            ++token_length);
-                        
-                        code_type = CODE_TYPE_constant;
-                        fprintf(file, "<span class=\"code_text\" style=\"color: #82c4e5;\">");
-                    }
-                    else if(node->string[i] == '"')
-                    {
-                        for(;
-                            node->string[i+token_length] &&
-                            node->string[i+token_length] != '"';
-                            ++token_length);
-                        
-                        ++token_length;
-                        
-                        code_type = CODE_TYPE_constant;
-                        fprintf(file, "<span class=\"code_text\" style=\"color: #82c4e5;\">");
-                    }
-                    else if(node->string[i] == '\'')
-                    {
-                        for(;
-                            node->string[i+token_length] &&
-                            node->string[i+token_length] != '\'';
-                            ++token_length);
-                        
-                        ++token_length;
-                        
-                        code_type = CODE_TYPE_constant;
-                        fprintf(file, "<span class=\"code_text\" style=\"color: #82c4e5;\">");
-                    }
-                    else if(node->string[i] == '@')
-                    {
-                        int nest_level = 0;
-                        for(; node->string[i+token_length]; ++token_length)
-                        {
-                            if(node->string[i+token_length] == '(')
-                            {
-                                nest_level += 1;
-                            }
-                            else if(node->string[i+token_length] == ')')
-                            {
-                                nest_level -= 1;
-                                if(nest_level <= 0)
-                                {
-                                    break;
-                                }
-                            }
-                            else if(node->string[i+token_length] <= 32)
-                            {
-                                if(nest_level == 0)
-                                {
-                                    break;
-                                }
-                            }
-                        }
-                        
-                        ++token_length;
-                        
-                        code_type = CODE_TYPE_Tag;
-                        fprintf(file, "<span class=\"code_text\" style=\"color: #d86312;\">");
-                    }
-                    
-                    for(int j = i; j < i + token_length; ++j)
+                    u64 selector_end = CSSSkipTo(prelude, prelude_length, selector_start, ",");
+                    if(!used_names || CSSSelectorIsUsed(prelude + selector_start, selector_end - selector_start,
+                                                        used_names, match_elements))
                     {
-                        if(node->string[j] == '<')
-                        {
-                            fprintf(file, "&lt;");
-                        }
-                        else if(node->string[j] == '>')
-                        {
-                            fprintf(file, "&gt;");
-                        }
-                        else if(node->string[j] == '&')
-                        {
-                            fprintf(file, "&amp;");
-                        }
-                        else
+                        if(out->size > rule_start)
                         {
-                            fprintf(file, "%c", node->string[j]);
+                            OutputBufferWriteN(out, ",", 1);
                         }
+                        OutputBufferWriteN(out, prelude + selector_start, selector_end - selector_start);
                     }
-                    
-                    i += token_length;
-                    
-                    if(code_type != CODE_TYPE_default)
-                    {
-                        fprintf(file, "</span>");
-                    }
+                    selector_start = selector_end+1;
                 }
-                
-                fprintf(file, "</pre></div>");
-                
-                break;
-            }
-            case PageNodeType_YouTube:
-            {
-                fprintf(file, "<div class=\"youtube\"><iframe width=\"100%%\" height=\"315\" src=\"");
-                
-                for(int i = 0; i < node->string_length; ++i)
+                if(out->size > rule_start)
                 {
-                    int length = CalculateCStringLength("watch?v=");
-                    if(CStringMatchCaseSensitiveN(node->string+i, "watch?v=", length))
-                    {
-                        fprintf(file, "embed/");
-                        i += length-1;
-                    }
-                    else
-                    {
-                        fprintf(file, "%c", node->string[i]);
-                    }
+                    OutputBufferWriteN(out, css + block_start, block_end+1 - block_start);
                 }
-                
-                fprintf(file, "\" frameborder=\"0\" allow=\"accelerometer; autoplay; encrypted-media; gyroscope; picture-in-picture\" allowfullscreen></iframe></div>");
-                break;
             }
-            case PageNodeType_Image:
+            i = block_end+1;
+        }
+    }
+    return i;
+}
+
+static void
+PruneCSS(char *css, u64 size, NameSet *used_names, int match_elements, OutputBuffer *out)
+{
+    for(u64 i = 0; i < size;)
+    {
+        i = PruneCSSRules(css, size, i, used_names, match_elements, out);
+
+        // NOTE(rjf): A stray '}' at the top level is kept, and the rules after it still pruned.
+        if(i < size)
+        {
+            OutputBufferWriteN(out, css + i, 1);
+            i += 1;
+        }
+    }
+}
+
+// NOTE(rjf): used_names may be null, to minify without pruning.
+static void
+MinifyCSS(char *css, u64 size, NameSet *used_names, OutputBuffer *out)
+{
+    OutputBuffer minified = {0};
+    MinifyCSSWhitespace(css, size, &minified);
+    PruneCSS(minified.data, minified.size, used_names, 0, out);
+    free(minified.data);
+}
+
+// NOTE(rjf): Prefixes relative url()s with the directory they were relative to, for CSS that
+// is moved out of its stylesheet. Absolute URLs, root-relative paths, fragments and data:
+// URLs are left alone.
+static void
+RewriteCSSURLs(char *css, u64 size, char *directory, OutputBuffer *out)
+{
+    u64 directory_length = CalculateCStringLength(directory);
+    for(u64 i = 0; i < size;)
+    {
+        if(css[i] == '"' || css[i] == '\'')
+        {
+            i = CopyQuotedRun(css, size, i, css[i], out);
+        }
+        else if(i+4 <= size && CStringMatchCaseSensitiveN(css+i, "url(", 4) && (i == 0 || !CharIsNameChar(css[i-1])))
+        {
+            OutputBufferWriteN(out, css+i, 4);
+            i += 4;
+            while(i < size && CharIsHTMLSpace(css[i]))
             {
-                fprintf(file, "<div class=\"image_container\"><img class=\"image\" src=\"%.*s\"></div>\n", node->string_length, node->string);
-                break;
+                ++i;
             }
-            case PageNodeType_ThumbnailImage:
+            char quote = (i < size && (css[i] == '"' || css[i] == '\'')) ? css[i] : 0;
+            u64 url_start = i + !!quote;
+            u64 url_end = url_start;
+            while(url_end < size && !strchr("\"')", css[url_end]) && !CharIsHTMLSpace(css[url_end]))
             {
-                if(!thumbnails_active)
-                {
-                    thumbnails_active = 1;
-                    fprintf(file, "<div class=\"thumbnail_image_container\">");
-                }
-                fprintf(file, "<a href=\"%.*s\"><img class=\"thumbnail_image\" src=\"%.*s\"></a>",
-                        node->string_length, node->string,
-                        node->string_length, node->string);
-                if(thumbnails_active && (!node->next || node->next->type != PageNodeType_ThumbnailImage))
-                {
-                    thumbnails_active = 0;
-                    fprintf(file, "</div>\n");
-                }
-                break;
+                ++url_end;
             }
-            case PageNodeType_Link:
+            char *url = css + url_start;
+            u64 url_length = url_end - url_start;
+            int is_relative = (url_length > 0 && url[0] != '/' && url[0] != '#' &&
+                               !(url_length >= 5 && CStringMatchCaseSensitiveN(url, "data:", 5)));
+            for(u64 j = 0; is_relative && j < url_length; ++j)
             {
-                if(paragraph_active)
-                {
-                    fprintf(file, "<a class=\"link\" href=\"%.*s\">%.*s</a>",
-                            node->link.url_length, node->link.url,
-                            node->string_length, node->string);
-                }
-                else
+                if(url[j] == ':')
                 {
-                    fprintf(file, "<div class=\"standalone_link_container\"><a class=\"link\" href=\"%.*s\">%.*s</a></div>",
-                            node->link.url_length, node->link.url,
-                            node->string_length, node->string);
+                    is_relative = 0;
                 }
-                
-                break;
             }
-            case PageNodeType_FeatureButton:
-            {
-                fprintf(file, "<div class=\"feature_button\">\n");
-                fprintf(file, "<a href=\"%.*s\">\n",
-                        node->feature_button.link_length, node->feature_button.link);
-                
-                fprintf(file, "<div class=\"feature_button_image\" style=\"background-image: url('%.*s');\"></div>\n",
-                        node->feature_button.image_path_length, node->feature_button.image_path);
-                
-                fprintf(file, "<div class=\"feature_button_text\">\n");
-                fprintf(file, "%.*s\n", node->string_length, node->string);
-                fprintf(file, "</div>\n");
-                
-                fprintf(file, "</a>\n");
-                fprintf(file, "</div>\n");
-                break;
-            }
-            case PageNodeType_Lister:
+            OutputBufferWriteN(out, css+i, url_start - i);
+            if(is_relative)
             {
-                char *prefix = node->string;
-                int prefix_length = node->string_length;
-                
-                for(int i = 0; i < file_count; ++i)
+                if(url_length >= 2 && url[0] == '.' && url[1] == '/')
                 {
-                    if(CStringMatchCaseSensitiveN(files[i].filename, prefix, prefix_length))
-                    {
-                        char *path = files[i].html_output_path;
-                        for(int j = 0; path[j]; ++j)
-                        {
-                            if(CStringMatchCaseSensitiveN(path+j, "generated/", 10))
-                            {
-                                path += 10;
-                                break;
-                            }
-                        }
-                        fprintf(file, "<a class=\"lister_link\" href=\"%s\">(%i/%i/%i) %s</a>\n", path,
-                                files[i].date_year, files[i].date_month, files[i].date_day, files[i].main_title);
-                    }
+                    url += 2;
+                    url_length -= 2;
                 }
-                
-                break;
+                OutputBufferWriteN(out, directory, directory_length);
             }
-            default: break;
+            OutputBufferWriteN(out, url, url_length);
+            i = url_end;
+            if(quote && i < size && css[i] == quote)
+            {
+                OutputBufferWriteN(out, css+i, 1);
+                i += 1;
+            }
+        }
+        else
+        {
+            OutputBufferWriteN(out, css+i, 1);
+            i += 1;
         }
     }
 }
 
-static void
-OutputHTMLFromPageNodeTreeToFile(PageNode *node, FILE *file, ProcessedFile *files, int file_count)
+static int
+JSCharIsIdentifier(char c)
 {
-    OutputHTMLFromPageNodeTreeToFile_(node, file, 1, files, file_count);
+    return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+            c == '_' || c == '$' || c == '\\' || (u8)c >= 0x80);
 }
 
-typedef struct SiteInfo SiteInfo;
-struct SiteInfo
+// NOTE(rjf): A '/' starts a regular expression where a value is expected: after an operator,
+// an opening bracket or a keyword like return, but not after a name or a closing bracket.
+static int
+JSSlashStartsRegex(OutputBuffer *out)
 {
-    char *canonical_url;
-    char *main_title;
-    char *author;
-    char *twitter_handle;
-    char* icon_path;
-};
+    int starts_regex = 1;
+    if(out->size)
+    {
+        char last = out->data[out->size-1];
+        if(JSCharIsIdentifier(last))
+        {
+            static char *keywords[] = { "return", "typeof", "case", "do", "else", "in", "of", "void", "yield", "throw", "delete" };
+            u64 word_start = out->size;
+            while(word_start > 0 && JSCharIsIdentifier(out->data[word_start-1]))
+            {
+                --word_start;
+            }
+            u64 word_length = out->size - word_start;
+            starts_regex = 0;
+            for(int i = 0; i < (int)(sizeof(keywords)/sizeof(keywords[0])); ++i)
+            {
+                if(CalculateCStringLength(keywords[i]) == word_length &&
+                   CStringMatchCaseSensitiveN(out->data + word_start, keywords[i], (int)word_length))
+                {
+                    starts_regex = 1;
+                    break;
+                }
+            }
+        }
+        else
+        {
+            starts_regex = (strchr(")]}\"'`", last) == 0);
+        }
+    }
+    return starts_regex;
+}
 
+// NOTE(rjf): Whitespace runs with a newline in them are kept as one newline, since automatic
+// semicolon insertion depends on them. Other runs are dropped unless they separate two names,
+// or two '+' or '-' that would otherwise run together into ++ or --.
 static void
-OutputHTMLHeader(SiteInfo *site_info, ProcessedFile *page)
+MinifyJS(char *js, u64 size, OutputBuffer *out)
 {
-    FILE *file = page->html_output_file;
-    fprintf(file, "<!DOCTYPE html>\n");
-    fprintf(file, "<html lang=\"en\">\n");
-    fprintf(file, "<head>\n");
-    fprintf(file, "<meta charset=\"utf-8\">");
-    // NOTE(bvisness): Consider adding mobile-friendly styles and then adding this line
-    fprintf(file, "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">");
-    fprintf(file, "<meta name=\"author\" content=\"%s\">\n", site_info->author);
-    fprintf(file, "<title>%s%s%s</title>\n", page->main_title, site_info->main_title ? " | " : "", site_info->main_title ? site_info->main_title : "");
-    fprintf(file, "<meta property=\"og:title\" content=\"%s\">\n", page->main_title);
-    fprintf(file, "<meta name=\"twitter:title\" content=\"%s\">\n", page->main_title);
-    if (page->description)
-    {
-        fprintf(file, "<meta name=\"description\" content=\"%s\">\n", page->description);
-        fprintf(file, "<meta property=\"og:description\" content=\"%s\">\n", page->description);
-        fprintf(file, "<meta name=\"twitter:description\" content=\"%s\">\n", page->description);
-    }
-    fprintf(file, "<link rel=\"canonical\" href=\"%s/%s\">\n", site_info->canonical_url, page->url);
-    fprintf(file, "<meta property=\"og:type\" content=\"website\">\n");
-    fprintf(file, "<meta property=\"og:url\" content=\"%s/%s\">\n", site_info->canonical_url, page->url);
-    fprintf(file, "<meta property=\"og:site_name\" content=\"%s\">\n", site_info->main_title ? site_info->main_title : "");
-    fprintf(file, "<meta name=\"twitter:card\" content=\"summary\">\n");
-    fprintf(file, "<meta name=\"twitter:site\" content=\"%s\">\n", site_info->twitter_handle ? site_info->twitter_handle : "");
-    fprintf(file, "<link rel=\"stylesheet\" type=\"text/css\" href=\"data/styles.css\">\n");
-    if(site_info->icon_path){
-        fprintf(file,"<link rel=\"icon\" type=\"image/png\" href=\"%s\">",site_info->icon_path);
-    }
-    fprintf(file, "</head>\n");
-    fprintf(file, "<body>\n");
-    if(page->html_header)
+    int pending_space = 0;
+    int pending_newline = 0;
+
+    for(u64 i = 0; i < size;)
     {
-        fprintf(file, "%s", page->html_header);
+        char c = js[i];
+        if(c == '/' && i+1 < size && js[i+1] == '/')
+        {
+            for(; i < size && js[i] != '\n'; ++i);
+            continue;
+        }
+        if(c == '/' && i+1 < size && js[i+1] == '*')
+        {
+            for(i += 2; i < size && !(js[i] == '*' && i+1 < size && js[i+1] == '/'); ++i)
+            {
+                pending_newline |= (js[i] == '\n');
+            }
+            i += 2;
+            pending_space = 1;
+            continue;
+        }
+        if(CharIsHTMLSpace(c))
+        {
+            pending_space = 1;
+            pending_newline |= (c == '\n');
+            ++i;
+            continue;
+        }
+
+        char last = out->size ? out->data[out->size-1] : 0;
+        if(last && pending_newline)
+        {
+            OutputBufferWriteN(out, "\n", 1);
+        }
+        else if(last && pending_space &&
+                ((JSCharIsIdentifier(last) && JSCharIsIdentifier(c)) || ((c == '+' || c == '-') && last == c)))
+        {
+            OutputBufferWriteN(out, " ", 1);
+        }
+        pending_space = 0;
+        pending_newline = 0;
+
+        if(c == '"' || c == '\'' || c == '`' || (c == '/' && JSSlashStartsRegex(out)))
+        {
+            i = CopyQuotedRun(js, size, i, c, out);
+        }
+        else
+        {
+            OutputBufferWriteN(out, &c, 1);
+            ++i;
+        }
     }
-    fprintf(file, "<div class=\"page_content\">\n");
 }
 
+//~ NOTE(rjf): Critical CSS
+//
+// The rules a page gets inlined depend only on which node types it has, since the frame,
+// header and footer are the same for every page. So the stylesheet is pruned once per
+// combination that some page uses, on the main thread before pages are emitted, and
+// OutputCriticalCSS just looks the result up.
+
 static void
-OutputHTMLFooter(SiteInfo *site_info, ProcessedFile *page)
+FreeCriticalCSS(SiteInfo *site_info)
 {
-    fprintf(page->html_output_file, "</div>\n");
-    if(page->html_footer)
+    for(int i = 0; i < site_info->critical_css_variant_count; ++i)
     {
-        fprintf(page->html_output_file, "%s", page->html_footer);
+        free(site_info->critical_css_variants[i].css);
     }
-    fprintf(page->html_output_file, "</body>\n");
-    fprintf(page->html_output_file, "</html>\n");
+    site_info->critical_css_variant_count = 0;
 }
 
-static ProcessedFile
-ProcessFile(char *filename, char *file, FileProcessData *process_data, ParseContext *context)
+// NOTE(rjf): Only adds the combinations that aren't there yet, so in --watch mode this is
+// cheap to call before every rebuild. A header or footer change needs FreeCriticalCSS first.
+static void
+PrepareCriticalCSS(SiteBuild *build)
 {
-    ProcessedFile processed_file = {0};
-    processed_file.filename = filename;
-    processed_file.output_flags = process_data->output_flags;
-    processed_file.html_header = process_data->html_header;
-    processed_file.html_footer = process_data->html_footer;
-    
-    if(process_data->input_type == InputType_HTML)
-    {
-        processed_file.html_file_contents = file;
-    }
-    else if(process_data->input_type == InputType_RXW)
+    SiteInfo *site_info = build->site_info;
+    if(site_info->critical_css)
     {
-        Tokenizer tokenizer_ = {0};
-        Tokenizer *tokenizer = &tokenizer_;
-        tokenizer->at = file;
-        tokenizer->line = 1;
-        tokenizer->file = filename;
-        
-        PageNode *page = ParseText(context, tokenizer);
-        processed_file.root = page;
+        NameSet frame_names = {0};
+        NameSetInsertWords(&frame_names, html_page_frame_names, CalculateCStringLength(html_page_frame_names));
+        if(build->html_header)
+        {
+            NameSetInsertWords(&frame_names, build->html_header, CalculateCStringLength(build->html_header));
+        }
+        if(build->html_footer)
+        {
+            NameSetInsertWords(&frame_names, build->html_footer, CalculateCStringLength(build->html_footer));
+        }
         
-        if(page)
+        for(int i = 0; i < build->file_count; ++i)
         {
-            for(PageNode *node = page; node; node = node->next)
+            ProcessedFile *file = build->files + i;
+            if(!(file->output_flags & OutputFlag_HTML) || file->input_type == InputType_HTML)
             {
-                if(node->type == PageNodeType_PageTitle)
-                {
-                    processed_file.main_title = ParseContextAllocateCStringCopyN(context, node->string, node->string_length);
-                    break;
-                }
+                continue;
             }
             
-            // NOTE(rjf): If a PageTitle has not been specified, then try to grab the first title and use it.
-            if(processed_file.main_title == 0)
+            u32 types_present = PageNodeTypesPresent(file->nodes);
+            int found = 0;
+            for(int j = 0; !found && j < site_info->critical_css_variant_count; ++j)
             {
-                processed_file.main_title = "";
-                for(PageNode *node = page; node; node = node->next)
-                {
-                    if(node->type == PageNodeType_Title)
-                    {
-                        processed_file.main_title = ParseContextAllocateCStringCopyN(context, node->string, node->string_length);
-                        break;
-                    }
-                }
+                found = (site_info->critical_css_variants[j].node_types == types_present);
+            }
+            if(found)
+            {
+                continue;
             }
             
-            for(PageNode *node = page; node; node = node->next)
+            NameSet names = frame_names;
+            names.hashes = malloc(sizeof(u64)*frame_names.capacity);
+            MemoryCopy(names.hashes, frame_names.hashes, sizeof(u64)*frame_names.capacity);
+            for(int type = 0; type < (int)(sizeof(html_page_node_names)/sizeof(html_page_node_names[0])); ++type)
             {
-                if(node->type == PageNodeType_Description)
+                if((types_present & (1u << type)) && html_page_node_names[type])
                 {
-                    processed_file.description = ParseContextAllocateCStringCopyN(context, node->string, node->string_length);
-                    break;
+                    NameSetInsertWords(&names, html_page_node_names[type], CalculateCStringLength(html_page_node_names[type]));
                 }
             }
             
-            for(PageNode *node = page; node; node = node->next)
+            OutputBuffer critical = {0};
+            PruneCSS(site_info->critical_css, site_info->critical_css_size, &names, 1, &critical);
+            free(names.hashes);
+            
+            if(site_info->critical_css_variant_count >= site_info->critical_css_variant_capacity)
             {
-                if(node->type == PageNodeType_Date)
-                {
-                    processed_file.date_year = node->date.year;
-                    processed_file.date_month = node->date.month;
-                    processed_file.date_day = node->date.day;
-                    break;
-                }
+                int capacity = site_info->critical_css_variant_capacity ? site_info->critical_css_variant_capacity*2 : 16;
+                site_info->critical_css_variants = realloc(site_info->critical_css_variants, sizeof(CriticalCSS)*capacity);
+                site_info->critical_css_variant_capacity = capacity;
             }
+            CriticalCSS *variant = site_info->critical_css_variants + site_info->critical_css_variant_count++;
+            variant->node_types = types_present;
+            variant->css = critical.data;
+            variant->size = critical.size;
         }
+        free(frame_names.hashes);
     }
-    
-    processed_file.url = ParseContextAllocateCStringCopy(context, process_data->filename_no_extension);
-    
-    if(process_data->output_flags & OutputFlag_HTML)
+}
+
+//~ NOTE(rjf): Assets
+//
+// --copy_assets mirrors a directory (or a single file) into the output folder, copying only
+// what changed. A destination with the same size and modification time as its source is
+// taken as up to date without being opened, since every copy we make is stamped with its
+// source's time. When only the time differs (e.g. a fresh checkout), the contents are
+// compared by hash, and a match just gets its time fixed. So a rebuild with unchanged assets
+// only stats files.
+//
+// With --gzip, text-like assets (see AssetIsCompressible) also get a .gz sibling, stamped with
+// the source's time the same way, so it is only recompressed when the source changes.
+//
+// With --minify, .css and .js assets are minified on every build instead (they are small, and
+// whether a stylesheet's rules are used depends on more than its own time), and written like
+// pages, so an unchanged result leaves the destination untouched.
+//
+// Files deleted from the source are left in the destination.
+
+typedef struct AssetFile AssetFile;
+struct AssetFile
+{
+    char *source_path;
+    char *destination_path;
+    FileInfo source_info;
+    int copied;
+    int compressed;
+    int failed;
+    int minified;
+    u64 minified_size;
+};
+
+typedef struct AssetSync AssetSync;
+struct AssetSync
+{
+    int gzip;
+    int minify;
+    NameSet used_names;
+    int file_count;
+    int file_capacity;
+    AssetFile *files;
+};
+
+static char *
+JoinPath(char *directory, char *name)
+{
+    int directory_length = CalculateCStringLength(directory);
+    int name_length = CalculateCStringLength(name);
+    char *path = malloc(directory_length + name_length + 2);
+    memcpy(path, directory, directory_length);
+    path[directory_length] = '/';
+    memcpy(path + directory_length + 1, name, name_length + 1);
+    return path;
+}
+
+// NOTE(rjf): Destination directories are made here, on one thread, so that the copying jobs
+// only ever touch files. Takes ownership of both (malloc'd) paths.
+static int
+CollectAssets(AssetSync *sync, char *source, char *destination)
+{
+    int success = 1;
+    FileInfo info = GetFileInfo(source);
+    if(!info.exists)
     {
-        processed_file.html_output_path = ParseContextAllocateCStringCopy(context, process_data->html_output_path);
-        processed_file.html_output_file = fopen(process_data->html_output_path, "wb");
+        fprintf(stderr, "ERROR: Could not find asset \"%s\".\n", source);
+        success = 0;
     }
-    
-    if(process_data->output_flags & OutputFlag_Markdown)
+    else if(info.is_directory)
     {
-        processed_file.markdown_output_path = ParseContextAllocateCStringCopy(context, process_data->md_output_path);
-        processed_file.markdown_output_file = fopen(process_data->md_output_path, "wb");
+        if(!MakeDirectory(destination))
+        {
+            fprintf(stderr, "ERROR: Could not create directory \"%s\".\n", destination);
+            success = 0;
+        }
+        else
+        {
+            int name_count = 0;
+            char **names = ListDirectory(source, &name_count);
+            for(int i = 0; i < name_count; ++i)
+            {
+                char *source_path = JoinPath(source, names[i]);
+                char *destination_path = JoinPath(destination, names[i]);
+                success = CollectAssets(sync, source_path, destination_path) && success;
+                free(names[i]);
+            }
+            free(names);
+        }
     }
     
-    if(process_data->output_flags & OutputFlag_BBCode)
+    if(!info.exists || info.is_directory)
     {
-        processed_file.bbcode_output_path = ParseContextAllocateCStringCopy(context, process_data->bbcode_output_path);
-        processed_file.bbcode_output_file = fopen(process_data->bbcode_output_path, "wb");
+        free(source);
+        free(destination);
     }
-    
-    return processed_file;
+    else
+    {
+        if(sync->file_count >= sync->file_capacity)
+        {
+            sync->file_capacity = sync->file_capacity ? sync->file_capacity*2 : 256;
+            sync->files = realloc(sync->files, sizeof(AssetFile)*sync->file_capacity);
+        }
+        AssetFile *file = sync->files + sync->file_count++;
+        MemorySet(file, 0, sizeof(*file));
+        file->source_path = source;
+        file->destination_path = destination;
+        file->source_info = info;
+    }
+    return success;
+}
+
+static int
+FileContentsMatch(char *a, char *b)
+{
+    u64 a_hash = 0;
+    u64 b_hash = 0;
+    u64 size = 0;
+    return (HashFileContents(a, &a_hash, &size) && HashFileContents(b, &b_hash, &size) && a_hash == b_hash);
 }
 
 static char *
-LoadEntireFileAndNullTerminate(char *filename)
+PathExtension(char *path)
 {
-    char *result = 0;
-    FILE *file = fopen(filename, "rb");
-    if(file)
+    char *extension = "";
+    for(char *at = path; *at; ++at)
+    {
+        if(*at == '.')
+        {
+            extension = at+1;
+        }
+        else if(*at == '/' || *at == '\\')
+        {
+            extension = "";
+        }
+    }
+    return extension;
+}
+
+// NOTE(rjf): Formats that are already compressed (images, woff/woff2 fonts) don't shrink.
+static int
+AssetIsCompressible(char *path)
+{
+    static char *extensions[] =
+    {
+        "html", "htm", "css", "js", "mjs", "json", "svg", "xml", "txt", "md", "ttf", "otf", "eot", "ico",
+    };
+    char *extension = PathExtension(path);
+    int compressible = 0;
+    for(int i = 0; i < (int)(sizeof(extensions)/sizeof(extensions[0])); ++i)
     {
-        fseek(file, 0, SEEK_END);
-        int file_size = ftell(file);
-        fseek(file, 0, SEEK_SET);
-        result = malloc(file_size+1);
-        if(result)
+        if(CStringMatchCaseInsensitive(extension, extensions[i]))
         {
-            fread(result, 1, file_size, file);
-            result[file_size] = 0;
+            compressible = 1;
+            break;
         }
     }
-    return result;
+    return compressible;
+}
+
+static int
+AssetIsCSS(char *path)
+{
+    return CStringMatchCaseInsensitive(PathExtension(path), "css");
+}
+
+static int
+AssetIsJS(char *path)
+{
+    return (CStringMatchCaseInsensitive(PathExtension(path), "js") ||
+            CStringMatchCaseInsensitive(PathExtension(path), "mjs"));
 }
 
 static void
-FreeFileData(void *data)
+MinifyAsset(AssetSync *sync, AssetFile *file)
 {
-    free(data);
+    FileData source = LoadFileData(file->source_path);
+    OutputBuffer minified = {0};
+    if(AssetIsCSS(file->source_path))
+    {
+        MinifyCSS(source.data, source.size, &sync->used_names, &minified);
+    }
+    else
+    {
+        MinifyJS(source.data, source.size, &minified);
+    }
+    
+    int had_gzip = GzipSiblingIsCurrent(file->destination_path);
+    
+    // NOTE(rjf): An empty source is written as an empty file, like a copy would be.
+    WriteResult result = WriteResult_Failed;
+    if(source.data || GetFileInfo(file->source_path).exists)
+    {
+        result = WriteOutputFile(file->destination_path, &minified, minified.size, 0, sync->gzip);
+    }
+    if(result == WriteResult_Failed)
+    {
+        fprintf(stderr, "ERROR: Could not minify \"%s\" to \"%s\".\n", file->source_path, file->destination_path);
+        file->failed = 1;
+    }
+    file->copied = (result == WriteResult_Written);
+    file->compressed = (sync->gzip && result != WriteResult_Failed && (file->copied || !had_gzip) &&
+                        GzipSiblingIsCurrent(file->destination_path));
+    file->minified = 1;
+    file->minified_size = minified.size;
+    
+    free(minified.data);
+    FreeFileData(&source);
 }
 
-typedef struct KeywordPrefixTreeNode KeywordPrefixTreeNode;
-struct KeywordPrefixTreeNode
+static void
+CopyAsset(AssetSync *sync, AssetFile *file)
 {
-    char *prefix;
-    int prefix_length;
-    char *value;
-    int value_length;
-    KeywordPrefixTreeNode *have_child;
-    KeywordPrefixTreeNode *no_have_child;
-};
+    FileInfo destination_info = GetFileInfo(file->destination_path);
+    int size_matches = (destination_info.exists && destination_info.size == file->source_info.size);
+    if(size_matches && destination_info.modified_time == file->source_info.modified_time)
+    {
+        // NOTE(rjf): Up to date.
+    }
+    else if(size_matches && FileContentsMatch(file->source_path, file->destination_path))
+    {
+        SetFileModifiedTime(file->destination_path, file->source_info.modified_time);
+    }
+    else if(CopyFileKeepingModifiedTime(file->source_path, file->destination_path,
+                                        file->source_info.modified_time))
+    {
+        file->copied = 1;
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Could not copy \"%s\" to \"%s\".\n", file->source_path, file->destination_path);
+        file->failed = 1;
+    }
+    
+    if(sync->gzip && !file->failed && AssetIsCompressible(file->source_path))
+    {
+        char gzip_path[1024] = {0};
+        snprintf(gzip_path, sizeof(gzip_path), "%s.gz", file->destination_path);
+        FileInfo gzip_info = GetFileInfo(gzip_path);
+        if(!gzip_info.exists || gzip_info.modified_time != file->source_info.modified_time)
+        {
+            FileData source = LoadFileData(file->source_path);
+            if(source.data && WriteGzipSibling(file->destination_path, (u8 *)source.data, source.size))
+            {
+                SetFileModifiedTime(gzip_path, file->source_info.modified_time);
+                file->compressed = 1;
+            }
+            FreeFileData(&source);
+        }
+    }
+}
 
-void
-InsertKeywordIntoTree(KeywordPrefixTreeNode **tree, ParseContext *context, char *key, int key_length, char *value, int value_length)
+static
+JOB_PROC(SyncAssetJob)
 {
-    KeywordPrefixTreeNode **node_target = tree;
-    for(KeywordPrefixTreeNode *node = *tree;;)
+    AssetSync *sync = user_data;
+    AssetFile *file = sync->files + job_index;
+    u64 start_time = ProfileBegin();
+    
+    if(sync->minify && (AssetIsCSS(file->source_path) || AssetIsJS(file->source_path)))
     {
-        int matching_key_characters = 0;
-        
-        if(node)
+        MinifyAsset(sync, file);
+    }
+    else
+    {
+        CopyAsset(sync, file);
+    }
+    
+    ProfileEnd(ProfilePhase_Assets, start_time, worker_index, file->source_path, 0);
+}
+
+static void
+SyncAssets(SiteBuild *build, char **sources, char **destinations, int count, int worker_count)
+{
+    AssetSync sync = {0};
+    sync.gzip = !!(build->output_flags & OutputFlag_Gzip);
+    sync.minify = !!(build->output_flags & OutputFlag_Minify);
+    for(int i = 0; i < count; ++i)
+    {
+        MakeParentDirectories(destinations[i]);
+        CollectAssets(&sync, sources[i], destinations[i]);
+    }
+    
+    // NOTE(rjf): Gather every name markup might use, before any stylesheet is pruned. See the
+    // CSS and JS Minification section.
+    if(sync.minify)
+    {
+        NameSetInsertWords(&sync.used_names, html_page_frame_names, CalculateCStringLength(html_page_frame_names));
+        for(int i = 0; i < (int)(sizeof(html_page_node_names)/sizeof(html_page_node_names[0])); ++i)
         {
-            for(int i = 0; i < node->prefix_length && i < key_length; ++i)
+            if(html_page_node_names[i])
             {
-                if(key[i]  == node->prefix[i])
-                {
-                    ++matching_key_characters;
-                }
-                else
-                {
-                    break;
-                }
+                NameSetInsertWords(&sync.used_names, html_page_node_names[i], CalculateCStringLength(html_page_node_names[i]));
             }
-            
-            // NOTE(rjf): We have matching characters, so this is either the node we want, or we want
-            // to allocate a new node on the "have" child.
-            if(matching_key_characters > 0)
+        }
+        if(build->html_header)
+        {
+            NameSetInsertWords(&sync.used_names, build->html_header, CalculateCStringLength(build->html_header));
+        }
+        if(build->html_footer)
+        {
+            NameSetInsertWords(&sync.used_names, build->html_footer, CalculateCStringLength(build->html_footer));
+        }
+        for(int i = 0; i < build->file_count; ++i)
+        {
+            if(build->files[i].input_type == InputType_HTML)
             {
-                if(node->prefix_length <= 1)
-                {
-                    node = node->have_child;
-                    node_target = &node->have_child;
-                }
-                else
-                {
-                    KeywordPrefixTreeNode *new_node = ParseContextAllocateMemory(context, sizeof(*new_node));
-                    new_node->have_child = node;
-                    new_node->no_have_child = 0;
-                    new_node->prefix = key;
-                    new_node->prefix_length = matching_key_characters;
-                    new_node->value = 0;
-                    new_node->value_length = 0;
-                    *node_target = new_node;
-                    node = new_node->no_have_child;
-                    node_target = &new_node->no_have_child;
-                }
+                FileData input = LoadFileData(build->input_filenames[i]);
+                NameSetInsertWords(&sync.used_names, input.data, input.size);
+                FreeFileData(&input);
             }
-            
-            // NOTE(rjf): We don't have any matching characters, so move to the no-have child.
-            else
+        }
+        for(int i = 0; i < sync.file_count; ++i)
+        {
+            char *extension = PathExtension(sync.files[i].source_path);
+            if(AssetIsJS(sync.files[i].source_path) ||
+               CStringMatchCaseInsensitive(extension, "html") || CStringMatchCaseInsensitive(extension, "htm"))
             {
-                node = node->no_have_child;
-                node_target = &node->no_have_child;
+                FileData source = LoadFileData(sync.files[i].source_path);
+                NameSetInsertWords(&sync.used_names, source.data, source.size);
+                FreeFileData(&source);
             }
         }
-        else
+    }
+    
+    RunJobs(SyncAssetJob, &sync, sync.file_count, worker_count);
+    
+    int copied_count = 0;
+    int compressed_count = 0;
+    int failed_count = 0;
+    int minified_count = 0;
+    u64 copied_bytes = 0;
+    u64 minified_source_bytes = 0;
+    u64 minified_bytes = 0;
+    for(int i = 0; i < sync.file_count; ++i)
+    {
+        AssetFile *file = sync.files + i;
+        if(file->copied)
+        {
+            copied_count += 1;
+            copied_bytes += file->source_info.size;
+        }
+        if(file->minified)
         {
-            KeywordPrefixTreeNode *new_node = ParseContextAllocateMemory(context, sizeof(*new_node));
-            new_node->have_child = 0;
-            new_node->no_have_child = 0;
-            new_node->prefix = key;
-            new_node->prefix_length = key_length;
-            new_node->value = value;
-            new_node->value_length = value_length;
-            *node_target = new_node;
-            break;
+            minified_count += 1;
+            minified_source_bytes += file->source_info.size;
+            minified_bytes += file->minified_size;
         }
+        compressed_count += file->compressed;
+        failed_count += file->failed;
+        free(file->source_path);
+        free(file->destination_path);
+    }
+    free(sync.files);
+    free(sync.used_names.hashes);
+    
+    Log("Assets: %i copied (%.2f MB), %i unchanged.", copied_count, copied_bytes / (1024.0*1024.0),
+        sync.file_count - copied_count - failed_count);
+    if(sync.minify)
+    {
+        Log("Assets: %i minified, %.1f KB down to %.1f KB.", minified_count,
+            minified_source_bytes / 1024.0, minified_bytes / 1024.0);
+    }
+    if(sync.gzip)
+    {
+        Log("Assets: %i gzipped.", compressed_count);
     }
 }
 
-int
-GetKeywordValueFromTree(KeywordPrefixTreeNode *tree, char *keyword, int keyword_length, char **value_ptr)
+//~ NOTE(rjf): Watch Mode
+//
+// After the initial build, we keep every ProcessedFile around and wait for inputs to change.
+// Only the touched file is re-parsed. Then every page's output hash is recomputed (which is
+// cheap compared to emission), and only pages whose hash changed get re-emitted, which is the
+// touched page itself plus any lister pages whose listing it changed.
+
+#if defined(__linux__)
+
+typedef struct WatchedFile WatchedFile;
+struct WatchedFile
 {
-    int value_length = 0;
+    char *path;
+    int watch_descriptor;
+    char *name;
+};
+
+static char *
+LoadWatchedHTMLFragment(char *path, char *old_contents)
+{
+    char *contents = LoadEntireFileAndNullTerminate(path);
+    if(contents)
+    {
+        if(old_contents)
+        {
+            free(old_contents);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Could not load \"%s\".\n", path);
+        contents = old_contents;
+    }
+    return contents;
+}
+
+static void
+WatchSite(SiteBuild *build, char *html_header_path, char *html_footer_path, int worker_count)
+{
+    int notify_fd = inotify_init1(IN_CLOEXEC);
+    if(notify_fd < 0)
+    {
+        fprintf(stderr, "ERROR: Could not initialize inotify.\n");
+        return;
+    }
     
-    for(KeywordPrefixTreeNode *node = tree; node;)
+    // NOTE(rjf): Editors commonly save by writing a new file and renaming it over the old one,
+    // so we watch the directories that contain inputs, rather than the inputs themselves.
+    int watched_file_count = build->file_count + 2;
+    WatchedFile *watched_files = calloc(watched_file_count, sizeof(WatchedFile));
+    for(int i = 0; i < watched_file_count; ++i)
     {
-        int matching_key_characters = 0;
-        
-        for(int i = 0; i < node->prefix_length && i < keyword_length; ++i)
+        char *path = (i < build->file_count ? build->input_filenames[i] :
+                      i == build->file_count ? html_header_path : html_footer_path);
+        if(path)
         {
-            if(keyword[i] == node->prefix[i])
+            char directory[4096] = {0};
+            snprintf(directory, sizeof(directory), "%s", path);
+            char *name = path;
+            char *last_slash = 0;
+            for(int j = 0; directory[j]; ++j)
             {
-                ++matching_key_characters;
+                if(directory[j] == '/')
+                {
+                    last_slash = directory+j;
+                }
+            }
+            if(last_slash)
+            {
+                *last_slash = 0;
+                name = path + (last_slash - directory) + 1;
             }
             else
             {
-                break;
+                snprintf(directory, sizeof(directory), ".");
+            }
+            
+            watched_files[i].path = path;
+            watched_files[i].name = name;
+            watched_files[i].watch_descriptor = inotify_add_watch(notify_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+            if(watched_files[i].watch_descriptor < 0)
+            {
+                fprintf(stderr, "ERROR: Could not watch directory \"%s\".\n", directory);
             }
         }
+    }
+    
+    Log("Watching for changes. Press Ctrl+C to stop.");
+    
+    int *changed = calloc(watched_file_count, sizeof(int));
+    ParseContext *page_contexts = calloc(build->file_count, sizeof(ParseContext));
+    static char event_buffer[64*1024];
+    for(;;)
+    {
+        int bytes_read = (int)read(notify_fd, event_buffer, sizeof(event_buffer));
+        if(bytes_read <= 0)
+        {
+            break;
+        }
         
-        if(matching_key_characters == node->prefix_length)
+        u64 start_time = GetTimeMicroseconds();
+        
+        // NOTE(rjf): Collapse all of the events in this batch into one set of changed files.
+        MemorySet(changed, 0, sizeof(int)*watched_file_count);
+        int any_changed = 0;
+        for(int offset = 0; offset < bytes_read;)
         {
-            if(matching_key_characters == keyword_length)
+            struct inotify_event *event = (struct inotify_event *)(event_buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+            if(event->len)
             {
-                if(value_ptr)
+                for(int i = 0; i < watched_file_count; ++i)
                 {
-                    *value_ptr = node->value;
-                    value_length = node->value_length;
-                    break;
+                    if(watched_files[i].path &&
+                       watched_files[i].watch_descriptor == event->wd &&
+                       CStringMatchCaseInsensitive(watched_files[i].name, event->name))
+                    {
+                        changed[i] = 1;
+                        any_changed = 1;
+                    }
                 }
             }
-            else
+        }
+        
+        if(!any_changed)
+        {
+            continue;
+        }
+        
+        // NOTE(rjf): Header and footer changes affect every page.
+        if(changed[build->file_count] || changed[build->file_count+1])
+        {
+            if(changed[build->file_count])
             {
-                node = node->have_child;
+                Log("Reloading \"%s\".", html_header_path);
+                build->html_header = LoadWatchedHTMLFragment(html_header_path, build->html_header);
+            }
+            if(changed[build->file_count+1])
+            {
+                Log("Reloading \"%s\".", html_footer_path);
+                build->html_footer = LoadWatchedHTMLFragment(html_footer_path, build->html_footer);
             }
+            for(int i = 0; i < build->file_count; ++i)
+            {
+                build->files[i].cold->html_header = build->html_header;
+                build->files[i].cold->html_footer = build->html_footer;
+            }
+            build->site_hash = HashSiteInfo(build->site_info, build->output_flags,
+                                            build->html_header, build->html_footer);
+            FreeCriticalCSS(build->site_info);
         }
-        else
+        
+        // NOTE(rjf): Re-parse touched pages. Files are sorted by date at this point, so we find
+        // each page's slot by its filename, which always points at the original argument.
+        // Each re-parsed page gets an arena of its own, so that the next edit to it can give
+        // back everything the old version used.
+        for(int i = 0; i < build->file_count; ++i)
         {
-            node = node->no_have_child;
+            if(changed[i])
+            {
+                char *filename = build->input_filenames[i];
+                for(int j = 0; j < build->file_count; ++j)
+                {
+                    ProcessedFile *old_file = build->files+j;
+                    if(old_file->filename == filename)
+                    {
+                        ParseContext new_context = {0};
+                        ProcessedFile new_file = LoadAndProcessFile(build, filename, &new_context, 0);
+                        if(!new_file.input_missing)
+                        {
+                            PrintParseErrors(&new_file);
+                            new_file.cold->html_output_hash = old_file->cold->html_output_hash;
+                            FreeFileData(&old_file->cold->source_file);
+                            free(old_file->cold->archive_output_hashes);
+                            ParseContextRelease(&page_contexts[i]);
+                            page_contexts[i] = new_context;
+                            *old_file = new_file;
+                        }
+                        else
+                        {
+                            ParseContextRelease(&new_context);
+                        }
+                        break;
+                    }
+                }
+            }
         }
+        
+        QuickSort(build->files, build->file_count, sizeof(ProcessedFile), ProcessedFileSortFunction);
+        BuildListerIndex(&build->listers, build->files, build->file_count);
+        
+        build->output_count = 0;
+        build->up_to_date_output_count = 0;
+        build->unchanged_output_count = 0;
+        PrepareCriticalCSS(build);
+        RunJobs(OutputFileJob, build, build->file_count, worker_count);
+        WriteBuildManifest(BUILD_MANIFEST_PATH, build->files, build->file_count);
+        
+        u64 end_time = GetTimeMicroseconds();
+        Log("Regenerated %i page(s) in %.2f ms.", build->output_count - build->up_to_date_output_count,
+            (end_time - start_time) / 1000.0);
+        fflush(stdout);
     }
     
-    return value_length;
+    for(int i = 0; i < build->file_count; ++i)
+    {
+        ParseContextRelease(&page_contexts[i]);
+    }
+    free(page_contexts);
+    free(changed);
+    free(watched_files);
 }
 
-KeywordPrefixTreeNode *
-GenerateKeywordPrefixTreeFromFile(ParseContext *context, char *filename)
+#else
+
+static void
+WatchSite(SiteBuild *build, char *html_header_path, char *html_footer_path, int worker_count)
 {
-    KeywordPrefixTreeNode *root = 0;
-    
-    char *file = LoadEntireFileAndNullTerminate(filename);
-    
-    for(int i = 0; file[i]; ++i)
-    {
-        char *key = 0;
-        int key_length = 0;
-        char *value = 0;
-        int value_length = 0;
-        if(!CharIsSpace(file[i]))
-        {
-            key = file+i+1;
-            for(; key[key_length] != ':'; ++key_length);
-            value = file+i+key_length+1;
-            for(int j = 0; CharIsSpace(file[i+key_length+j]); ++j, ++value);
-            for(; value[value_length] != '\n'; ++value_length);
-            InsertKeywordIntoTree(&root, context, key, key_length, value, value_length);
-        }
-    }
-    
-    FreeFileData(file);
-    
-    return root;
+    fprintf(stderr, "ERROR: --watch is not supported on this platform yet.\n");
 }
 
+#endif
+
+#if !defined(GENERATOR_NO_MAIN)
 int
 main(int argument_count, char **arguments)
 {
@@ -1982,9 +7364,18 @@ main(int argument_count, char **arguments)
     OutputFlags output_flags = 0;
     char *html_header_path = 0;
     char *html_footer_path = 0;
+    char *critical_css_path = 0;
     char *html_header = "";
     char *html_footer = "";
     SiteInfo site_info = {0};
+    int worker_count = 1;
+    int incremental = 0;
+    int watch = 0;
+    int stats = 0;
+    int profile = 0;
+    int asset_count = 0;
+    char **asset_sources = malloc(sizeof(char *)*argument_count);
+    char **asset_destinations = malloc(sizeof(char *)*argument_count);
     
     for(int i = 1; i < argument_count; ++i)
     {
@@ -2008,8 +7399,54 @@ main(int argument_count, char **arguments)
             output_flags |= OutputFlag_BBCode;
             arguments[i] = 0;
         }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--minify"))
+        {
+            Log("Minifying HTML output, and CSS and JS assets.");
+            output_flags |= OutputFlag_Minify;
+            arguments[i] = 0;
+        }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--gzip"))
+        {
+            Log("Writing gzipped copies of pages and assets.");
+            output_flags |= OutputFlag_Gzip;
+            arguments[i] = 0;
+        }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--incremental"))
+        {
+            Log("Skipping outputs that are unchanged since the last build.");
+            incremental = 1;
+            arguments[i] = 0;
+        }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--stats"))
+        {
+            stats = 1;
+            arguments[i] = 0;
+        }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--profile"))
+        {
+            Log("Profiling the build.");
+            profile = 1;
+            arguments[i] = 0;
+        }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--watch"))
+        {
+            Log("Watching inputs for changes after building.");
+            watch = 1;
+            arguments[i] = 0;
+        }
         
         // NOTE(rjf): Arguments with input data (not just flags).
+        else if(argument_count > i+2 && CStringMatchCaseInsensitive(arguments[i], "--copy_assets"))
+        {
+            asset_sources[asset_count] = strdup(arguments[i+1]);
+            asset_destinations[asset_count] = strdup(arguments[i+2]);
+            Log("Copying assets from \"%s\" to \"%s\".", arguments[i+1], arguments[i+2]);
+            ++asset_count;
+            arguments[i] = 0;
+            arguments[i+1] = 0;
+            arguments[i+2] = 0;
+            i += 2;
+        }
         else if(argument_count > i+1)
         {
             if(CStringMatchCaseInsensitive(arguments[i], "--html_header"))
@@ -2028,6 +7465,13 @@ main(int argument_count, char **arguments)
                 arguments[i+1] = 0;
                 ++i;
             }
+            else if(CStringMatchCaseInsensitive(arguments[i], "--critical_css"))
+            {
+                critical_css_path = arguments[i+1];
+                arguments[i] = 0;
+                arguments[i+1] = 0;
+                ++i;
+            }
             else if(CStringMatchCaseInsensitive(arguments[i], "--main_title"))
             {
                 site_info.main_title = arguments[i+1];
@@ -2060,6 +7504,18 @@ main(int argument_count, char **arguments)
                 arguments[i+1] = 0;
                 ++i;
             }
+            else if(CStringMatchCaseInsensitive(arguments[i], "--jobs"))
+            {
+                worker_count = CStringToInt(arguments[i+1]);
+                if(worker_count <= 0)
+                {
+                    worker_count = GetProcessorCount();
+                }
+                Log("Using %i worker threads.", worker_count);
+                arguments[i] = 0;
+                arguments[i+1] = 0;
+                ++i;
+            }
             else if(CStringMatchCaseInsensitive(arguments[i], "--icon")){
                 site_info.icon_path = arguments[i+1];
                 Log("Favicon path set as \"%s\".", site_info.icon_path);
@@ -2077,132 +7533,199 @@ main(int argument_count, char **arguments)
         
     }
     
+    // NOTE(rjf): A header or footer that fails to load is left out of every page. The empty
+    // fallback is allocated, since --watch frees the old contents when the file comes back.
     if(html_header_path)
     {
         html_header = LoadEntireFileAndNullTerminate(html_header_path);
+        if(!html_header)
+        {
+            fprintf(stderr, "ERROR: Could not load HTML header \"%s\".\n", html_header_path);
+            html_header = calloc(1, 1);
+        }
     }
     
     if(html_footer_path)
     {
         html_footer = LoadEntireFileAndNullTerminate(html_footer_path);
+        if(!html_footer)
+        {
+            fprintf(stderr, "ERROR: Could not load HTML footer \"%s\".\n", html_footer_path);
+            html_footer = calloc(1, 1);
+        }
     }
     
-    ParseContext context = {0};
-    ProcessedFile files[4096];
-    int file_count = 0;
+    if(critical_css_path)
+    {
+        FileData stylesheet = LoadFileData(critical_css_path);
+        OutputBuffer minified = {0};
+        OutputBuffer rewritten = {0};
+        MinifyCSSWhitespace(stylesheet.data, stylesheet.size, &minified);
+        RewriteCSSURLs(minified.data, minified.size, HTML_STYLESHEET_DIRECTORY, &rewritten);
+        
+        // NOTE(rjf): A "</" would end the <style> element early.
+        int closes_element = 0;
+        for(u64 i = 0; i+1 < rewritten.size; ++i)
+        {
+            closes_element = closes_element || (rewritten.data[i] == '<' && rewritten.data[i+1] == '/');
+        }
+        
+        if(!stylesheet.data)
+        {
+            fprintf(stderr, "ERROR: Could not load stylesheet \"%s\"; not inlining critical CSS.\n", critical_css_path);
+        }
+        else if(closes_element)
+        {
+            fprintf(stderr, "ERROR: Stylesheet \"%s\" contains \"</\"; not inlining critical CSS.\n", critical_css_path);
+        }
+        else
+        {
+            Log("Inlining critical CSS from \"%s\".", critical_css_path);
+            site_info.critical_css = rewritten.data;
+            site_info.critical_css_size = rewritten.size;
+        }
+        if(!site_info.critical_css)
+        {
+            free(rewritten.data);
+        }
+        FreeFileData(&stylesheet);
+        free(minified.data);
+    }
     
-    for(int i = 1; i < argument_count; ++i)
+    SiteBuild build = {0};
     {
-        char *filename = arguments[i];
-        if(filename)
+        build.site_info = &site_info;
+        build.output_flags = output_flags;
+        build.html_header = html_header;
+        build.html_footer = html_footer;
+        build.worker_contexts = calloc(worker_count, sizeof(ParseContext));
+        build.worker_output_buffers = calloc(worker_count, sizeof(OutputBuffer));
+        build.incremental = incremental;
+        build.site_hash = HashSiteInfo(&site_info, output_flags, html_header, html_footer);
+        if(incremental)
         {
-            Log("Processing file \"%s\".", filename);
-            
-            char *file = LoadEntireFileAndNullTerminate(filename);
-            
-            char extension[256] = {0};
-            char filename_no_extension[256] = {0};
-            char html_output_path[256] = {0};
-            char md_output_path[256] = {0};
-            char bbcode_output_path[256] = {0};
-            
-            snprintf(filename_no_extension, sizeof(filename_no_extension), "%s", filename);
-            char *last_period = filename_no_extension;
-            for(int i = 0; filename_no_extension[i]; ++i)
-            {
-                if(filename_no_extension[i] == '.')
-                {
-                    last_period = filename_no_extension+i;
-                }
-            }
-            *last_period = 0;
-            
-            snprintf(html_output_path, sizeof(html_output_path), "generated/%s.html", filename_no_extension);
-            snprintf(md_output_path, sizeof(md_output_path), "generated/%s.md", filename_no_extension);
-            snprintf(bbcode_output_path, sizeof(bbcode_output_path), "generated/%s.bbcode", filename_no_extension);
-            
-            snprintf(extension, sizeof(extension), "%s", last_period+1);
-            InputType input_type = InputType_RXW;
-            if(CStringMatchCaseInsensitive(extension, "html"))
-            {
-                input_type = InputType_HTML;
-            }
-            
-            FileProcessData process_data = {0};
-            {
-                process_data.input_type = input_type;
-                process_data.output_flags = output_flags;
-                process_data.filename_no_extension = filename_no_extension;
-                process_data.html_output_path = html_output_path;
-                process_data.md_output_path = md_output_path;
-                process_data.bbcode_output_path = bbcode_output_path;
-                process_data.html_header = html_header;
-                process_data.html_footer = html_footer;
-            }
-            
-            ProcessedFile processed_file = ProcessFile(filename, file, &process_data, &context);
-            
-            if(file_count < sizeof(files)/sizeof(files[0]))
-            {
-                files[file_count++] = processed_file;
-            }
-            else
+            build.manifest = LoadBuildManifest(BUILD_MANIFEST_PATH);
+        }
+        
+        for(int i = 1; i < argument_count; ++i)
+        {
+            if(arguments[i])
             {
-                fprintf(stderr, "ERROR: Max file count reached. @Ryan, increase this.\n");
+                AddInputFile(&build, arguments[i]);
             }
-            
         }
     }
     
+    ProcessedFile *files = build.files;
+    int file_count = build.file_count;
+    
+    if(profile)
+    {
+        ProfilerInit(worker_count);
+    }
+    
+    // NOTE(rjf): Load and parse all input files.
+    {
+        RunJobs(ProcessInputFileJob, &build, file_count, worker_count);
+    }
+    
     // NOTE(rjf): Print errors.
-    if(context.error_stack_size > 0)
     {
-        for(int i = 0; i < context.error_stack_size; ++i)
+        int error_count = 0;
+        int error_file_count = 0;
+        for(int i = 0; i < file_count; ++i)
+        {
+            PrintParseErrors(files+i);
+            if(files[i].cold->error_count)
+            {
+                error_count += files[i].cold->error_count;
+                error_file_count += 1;
+            }
+        }
+        if(error_count)
         {
-            fprintf(stderr, "Parse Error (%s:%i): %s\n",
-                    context.error_stack[i].file,
-                    context.error_stack[i].line,
-                    context.error_stack[i].message);
+            fprintf(stderr, "%i parse error(s) in %i file(s).\n", error_count, error_file_count);
         }
     }
     
-    // NOTE(rjf): Sort files by date.
+    // NOTE(rjf): Sort files by date, and index them for listers. This needs every file's
+    // metadata, so it is the barrier between the parsing and output phases.
     {
+        u64 sort_start_time = ProfileBegin();
         QuickSort(files, file_count, sizeof(ProcessedFile), ProcessedFileSortFunction);
+        BuildListerIndex(&build.listers, files, file_count);
+        ProfileEnd(ProfilePhase_Sort, sort_start_time, 0, 0, 0);
     }
     
     // NOTE(rjf): Generate code for all processed files.
+    {
+        PrepareCriticalCSS(&build);
+        RunJobs(OutputFileJob, &build, file_count, worker_count);
+    }
+    
+    if(asset_count)
+    {
+        SyncAssets(&build, asset_sources, asset_destinations, asset_count, worker_count);
+    }
+    
+    // NOTE(rjf): Remember what we generated, for the next incremental build.
+    {
+        WriteBuildManifest(BUILD_MANIFEST_PATH, files, file_count);
+        if(incremental)
+        {
+            Log("%i of %i pages were already up to date.", build.up_to_date_output_count, build.output_count);
+        }
+        Log("%i of %i emitted pages matched the existing file, and were left untouched.",
+            build.unchanged_output_count, build.output_count - build.up_to_date_output_count);
+    }
+    
+    // NOTE(rjf): Only the initial build is profiled, not rebuilds in --watch mode.
+    if(profile)
+    {
+        PrintProfileSummary(files, file_count);
+        if(WriteProfileTrace(PROFILE_TRACE_PATH))
+        {
+            Log("Wrote trace to \"%s\".", PROFILE_TRACE_PATH);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Could not write \"%s\".\n", PROFILE_TRACE_PATH);
+        }
+        profiler.enabled = 0;
+    }
+    
+    if(stats)
+    {
+        int block_allocation_count = 0;
+        u64 reserved_size = 0;
+        u64 used_size = 0;
+        for(int i = 0; i < worker_count; ++i)
+        {
+            block_allocation_count += build.worker_contexts[i].arena.block_allocation_count;
+            reserved_size += build.worker_contexts[i].arena.reserved_size;
+            used_size += ArenaUsedSize(&build.worker_contexts[i].arena);
+        }
+        Log("Peak memory usage: %.2f MB.", GetPeakMemoryUsage() / (1024.0*1024.0));
+        Log("Parse arenas: %.2f MB used of %.2f MB in %i block allocation(s).",
+            used_size / (1024.0*1024.0), reserved_size / (1024.0*1024.0), block_allocation_count);
+        Log("Interned strings: %u distinct of %llu, %.2f KB.", string_table.count ? string_table.count-1 : 0,
+            (unsigned long long)string_table.intern_count, string_table.interned_bytes / 1024.0);
+    }
+    
+    if(watch)
+    {
+        WatchSite(&build, html_header_path, html_footer_path, worker_count);
+    }
+    
+    // NOTE(rjf): Page nodes point into the source files, so these live until every page has
+    // been emitted.
     {
         for(int i = 0; i < file_count; ++i)
         {
-            ProcessedFile *file = files+i;
-            
-            if(file->html_output_file)
-            {
-                OutputHTMLHeader(&site_info, file);
-                if(file->root)
-                {
-                    OutputHTMLFromPageNodeTreeToFile(file->root, file->html_output_file,
-                                                     files, file_count);
-                }
-                else if(file->html_file_contents)
-                {
-                    fprintf(file->html_output_file, "%s", file->html_file_contents);
-                }
-                OutputHTMLFooter(&site_info, file);
-            }
-            
-            if(file->markdown_output_file)
-            {
-                // TODO(rjf)
-            }
-            
-            if(file->bbcode_output_file)
-            {
-                // TODO(rjf)
-            }
+            FreeFileData(&files[i].cold->source_file);
         }
     }
     
     return 0;
 }
+#endif // !defined(GENERATOR_NO_MAIN)
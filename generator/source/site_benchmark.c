@@ -0,0 +1,410 @@
+// NOTE(rjf): Whole-site benchmark.
+//
+// Writes a synthetic site in the style of sites/personal (blog posts with titles, dates,
+// descriptions, prose with inline styling and links, code blocks, images, and lister pages
+// that index the posts), then runs the generator over it a number of times and reports how
+// long each build took, as input megabytes per second and pages per second, with the spread
+// across runs. The corpus only depends on the options and the seed, so results from
+// different versions of the generator are comparable.
+//
+// Usage: site_benchmark [options]
+//
+//   --generator <path>     Generator executable to run (default: ./generator).
+//   --directory <path>     Where to write the corpus (default: site_benchmark_corpus).
+//   --pages <n>            Number of posts (default: 1000).
+//   --paragraphs <n>       Paragraphs per post (default: 12).
+//   --paragraph_words <n>  Average words per paragraph (default: 80).
+//   --code_density <n>     Percent chance that a paragraph is followed by a code block (default: 15).
+//   --tag_density <n>      Percent chance that a sentence has an inline link, image, or style (default: 20).
+//   --listers <n>          Number of lister pages; posts are split evenly between them (default: 4).
+//   --page_size <n>        Paginate listers with this many posts per page; 0 for one page (default: 0).
+//   --runs <n>             Timed runs (default: 5), after one untimed warm-up run.
+//   --jobs <n>             Passed on to the generator.
+//   --seed <n>             Seed for the corpus (default: 1234).
+//   --no_generate          Reuse the corpus already in --directory.
+
+// NOTE(rjf): This pulls in the whole generator, most of which only its main() calls.
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#define GENERATOR_NO_MAIN
+#include "generator.c"
+
+#include <math.h>
+
+#if defined(_WIN32)
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+typedef struct CorpusOptions CorpusOptions;
+struct CorpusOptions
+{
+    int pages;
+    int paragraphs;
+    int paragraph_words;
+    int code_density;
+    int tag_density;
+    int listers;
+    int page_size;
+    u32 seed;
+};
+
+static u32
+NextRandom(u32 *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static char *corpus_words[] =
+{
+    "the", "entity", "memory", "system", "data", "is", "a", "of", "to", "and", "code",
+    "generation", "parser", "which", "allows", "for", "very", "simple", "engine", "that",
+    "structure", "in", "game", "design", "with", "each", "frame", "it", "we", "can",
+    "introspection", "compile", "time", "player", "position", "velocity", "function", "table",
+};
+
+static char *
+RandomWord(u32 *random)
+{
+    return corpus_words[NextRandom(random) % (sizeof(corpus_words)/sizeof(corpus_words[0]))];
+}
+
+static void
+AppendSentence(OutputBuffer *buffer, u32 *random, int word_count, int tag_density)
+{
+    int tag_word = -1;
+    if((int)(NextRandom(random) % 100) < tag_density)
+    {
+        tag_word = NextRandom(random) % word_count;
+    }
+
+    for(int i = 0; i < word_count; ++i)
+    {
+        char *word = RandomWord(random);
+        if(i == tag_word)
+        {
+            switch(NextRandom(random) % 5)
+            {
+                case 0:
+                {
+                    OutputBufferAppendString(buffer, "@Link {\"");
+                    OutputBufferAppendString(buffer, word);
+                    OutputBufferAppendString(buffer, "\", \"https://ryanfleury.net/");
+                    OutputBufferAppendString(buffer, word);
+                    OutputBufferAppendString(buffer, ".html\"} ");
+                    break;
+                }
+                case 1: { OutputBufferAppendString(buffer, "*"); OutputBufferAppendString(buffer, word); OutputBufferAppendString(buffer, "* "); break; }
+                case 2: { OutputBufferAppendString(buffer, "`"); OutputBufferAppendString(buffer, word); OutputBufferAppendString(buffer, "` "); break; }
+                case 3: { OutputBufferAppendString(buffer, "|"); OutputBufferAppendString(buffer, word); OutputBufferAppendString(buffer, "| "); break; }
+                case 4:
+                {
+                    OutputBufferAppendString(buffer, word);
+                    OutputBufferAppendString(buffer, "\n\n@Image {\"data/");
+                    OutputBufferAppendString(buffer, word);
+                    OutputBufferAppendString(buffer, ".png\"}\n\n");
+                    break;
+                }
+            }
+        }
+        else
+        {
+            OutputBufferAppendString(buffer, word);
+            OutputBufferAppendString(buffer, i+1 < word_count ? " " : ". ");
+        }
+    }
+}
+
+static void
+AppendPost(OutputBuffer *buffer, CorpusOptions *options, u32 *random, int page_index)
+{
+    OutputBufferAppendString(buffer, "@Title {\"");
+    for(int i = 0; i < 4; ++i)
+    {
+        char *word = RandomWord(random);
+        OutputBufferAppendChar(buffer, word[0] - 'a' + 'A');
+        OutputBufferAppendString(buffer, word+1);
+        OutputBufferAppendString(buffer, i < 3 ? " " : "");
+    }
+    OutputBufferAppendString(buffer, "\"}\n@Description {\"");
+    AppendSentence(buffer, random, 12, 0);
+    OutputBufferAppendString(buffer, "\"}\n@Date {");
+    OutputBufferAppendInt(buffer, 2010 + page_index % 12);
+    OutputBufferAppendChar(buffer, '/');
+    OutputBufferAppendInt(buffer, 1 + NextRandom(random) % 12);
+    OutputBufferAppendChar(buffer, '/');
+    OutputBufferAppendInt(buffer, 1 + NextRandom(random) % 28);
+    OutputBufferAppendString(buffer, "}\n\n");
+
+    for(int paragraph = 0; paragraph < options->paragraphs; ++paragraph)
+    {
+        if(paragraph > 0 && NextRandom(random) % 6 == 0)
+        {
+            OutputBufferAppendString(buffer, "@SubTitle {\"");
+            OutputBufferAppendString(buffer, RandomWord(random));
+            OutputBufferAppendString(buffer, " ");
+            OutputBufferAppendString(buffer, RandomWord(random));
+            OutputBufferAppendString(buffer, "\"}\n\n");
+        }
+
+        int words_left = options->paragraph_words/2 + NextRandom(random) % (options->paragraph_words+1);
+        while(words_left > 0)
+        {
+            int sentence_words = 6 + NextRandom(random) % 14;
+            sentence_words = sentence_words < words_left ? sentence_words : words_left;
+            AppendSentence(buffer, random, sentence_words, options->tag_density);
+            words_left -= sentence_words;
+        }
+        OutputBufferAppendString(buffer, "\n\n");
+
+        if((int)(NextRandom(random) % 100) < options->code_density)
+        {
+            OutputBufferAppendString(buffer, "@Code\n{\nstatic void\nHitPlayer(Player *player, Vec3 attack_position, float attack_radius)\n{\n"
+                                     "    if(SpheresIntersect(player->position, player->radius, attack_position, attack_radius))\n    {\n"
+                                     "        // NOTE: Knock the player back.\n        player->velocity = Vec3AddVec3(player->velocity, Vec3SubtractVec3(player->position, attack_position));\n"
+                                     "        player->health -= 0.1f;\n    }\n}\n}\n\n");
+        }
+    }
+}
+
+static int
+WriteBufferToFile(char *path, OutputBuffer *buffer)
+{
+    int success = 0;
+    FILE *file = fopen(path, "wb");
+    if(file)
+    {
+        success = fwrite(buffer->data, 1, buffer->size, file) == buffer->size;
+        success = !fclose(file) && success;
+    }
+    if(!success)
+    {
+        fprintf(stderr, "ERROR: Could not write \"%s\".\n", path);
+    }
+    return success;
+}
+
+static void
+FormatPostFilename(char *filename, int size, CorpusOptions *options, int page_index)
+{
+    if(options->listers > 0)
+    {
+        snprintf(filename, size, "blog%i_%05i.rxw", page_index % options->listers, page_index);
+    }
+    else
+    {
+        snprintf(filename, size, "post_%05i.rxw", page_index);
+    }
+}
+
+// NOTE(rjf): Writes the corpus, and returns the names of its input files as one string to go
+// on the generator's command line. Also reports the total size of the inputs.
+static char *
+GenerateCorpus(char *directory, CorpusOptions *options, int write_files, u64 *byte_count_out)
+{
+    char path[1024] = {0};
+    OutputBuffer buffer = {0};
+    OutputBuffer file_list = {0};
+    u32 random = options->seed;
+    u64 byte_count = 0;
+    int success = 1;
+
+    if(write_files)
+    {
+        MakeDirectory(directory);
+        snprintf(path, sizeof(path), "%s/generated", directory);
+        MakeDirectory(path);
+
+        buffer.size = 0;
+        OutputBufferAppendString(&buffer, "<div class=\"header\"><a href=\"index.html\">Synthetic Site</a></div>\n<div class=\"page_content\">\n");
+        snprintf(path, sizeof(path), "%s/header.html", directory);
+        success = success && WriteBufferToFile(path, &buffer);
+
+        buffer.size = 0;
+        OutputBufferAppendString(&buffer, "</div>\n<div class=\"footer\">Generated for benchmarking.</div>\n");
+        snprintf(path, sizeof(path), "%s/footer.html", directory);
+        success = success && WriteBufferToFile(path, &buffer);
+    }
+
+    for(int i = 0; success && i < options->pages + options->listers; ++i)
+    {
+        char filename[64] = {0};
+        buffer.size = 0;
+        if(i < options->pages)
+        {
+            FormatPostFilename(filename, sizeof(filename), options, i);
+            AppendPost(&buffer, options, &random, i);
+        }
+        else
+        {
+            int lister = i - options->pages;
+            snprintf(filename, sizeof(filename), "blog%i.rxw", lister);
+            OutputBufferAppendString(&buffer, "@Title {\"Blog ");
+            OutputBufferAppendInt(&buffer, lister);
+            OutputBufferAppendString(&buffer, "\"}\n\nThe following blog posts explore different technical problems.\n\n@Lister {\"blog");
+            OutputBufferAppendInt(&buffer, lister);
+            OutputBufferAppendString(&buffer, "_\"");
+            if(options->page_size > 0)
+            {
+                OutputBufferAppendString(&buffer, ", ");
+                OutputBufferAppendInt(&buffer, options->page_size);
+            }
+            OutputBufferAppendString(&buffer, "}\n");
+        }
+
+        byte_count += buffer.size;
+        if(write_files)
+        {
+            snprintf(path, sizeof(path), "%s/%s", directory, filename);
+            success = WriteBufferToFile(path, &buffer);
+        }
+        OutputBufferAppendChar(&file_list, ' ');
+        OutputBufferAppendString(&file_list, filename);
+    }
+    OutputBufferAppendChar(&file_list, 0);
+
+    free(buffer.data);
+    *byte_count_out = byte_count;
+    if(!success)
+    {
+        free(file_list.data);
+        file_list.data = 0;
+    }
+    return file_list.data;
+}
+
+int
+main(int argument_count, char **arguments)
+{
+    char *generator = "./generator";
+    char *directory = "site_benchmark_corpus";
+    char *jobs = 0;
+    int runs = 5;
+    int write_files = 1;
+    CorpusOptions options = {0};
+    {
+        options.pages = 1000;
+        options.paragraphs = 12;
+        options.paragraph_words = 80;
+        options.code_density = 15;
+        options.tag_density = 20;
+        options.listers = 4;
+        options.page_size = 0;
+        options.seed = 1234;
+    }
+
+    for(int i = 1; i < argument_count; ++i)
+    {
+        char *value = i+1 < argument_count ? arguments[i+1] : 0;
+        if(CStringMatchCaseInsensitive(arguments[i], "--no_generate"))
+        {
+            write_files = 0;
+        }
+        else if(!value)
+        {
+            fprintf(stderr, "ERROR: \"%s\" expects a value, or is not a known option.\n", arguments[i]);
+            return 1;
+        }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--generator"))       { generator = value; ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--directory"))       { directory = value; ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--jobs"))            { jobs = value; ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--runs"))            { runs = CStringToInt(value); ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--pages"))           { options.pages = CStringToInt(value); ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--paragraphs"))      { options.paragraphs = CStringToInt(value); ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--paragraph_words")) { options.paragraph_words = CStringToInt(value); ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--code_density"))    { options.code_density = CStringToInt(value); ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--tag_density"))     { options.tag_density = CStringToInt(value); ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--listers"))         { options.listers = CStringToInt(value); ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--page_size"))       { options.page_size = CStringToInt(value); ++i; }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--seed"))            { options.seed = (u32)CStringToInt(value); ++i; }
+        else
+        {
+            fprintf(stderr, "ERROR: Unknown option \"%s\".\n", arguments[i]);
+            return 1;
+        }
+    }
+
+    if(runs <= 0 || options.pages <= 0 || options.paragraphs < 0 || options.paragraph_words <= 0 || options.listers < 0)
+    {
+        fprintf(stderr, "ERROR: --runs, --pages, and --paragraph_words must be positive.\n");
+        return 1;
+    }
+
+    // NOTE(rjf): The generator runs from inside the corpus directory, so a relative path to it
+    // has to be made absolute first.
+    char generator_path[1024] = {0};
+#if defined(_WIN32)
+    if(!_fullpath(generator_path, generator, sizeof(generator_path)))
+#else
+    if(!realpath(generator, generator_path))
+#endif
+    {
+        fprintf(stderr, "ERROR: Could not find the generator at \"%s\".\n", generator);
+        return 1;
+    }
+
+    u64 byte_count = 0;
+    u64 generate_start_time = GetTimeMicroseconds();
+    char *file_list = GenerateCorpus(directory, &options, write_files, &byte_count);
+    if(!file_list)
+    {
+        return 1;
+    }
+    int page_count = options.pages + options.listers;
+    Log("Corpus: %i pages, %.2f MB in \"%s\" (%s in %.2f s).", page_count, byte_count / (1024.0*1024.0), directory,
+        write_files ? "written" : "reused", (GetTimeMicroseconds() - generate_start_time) / 1000000.0);
+
+    u64 command_size = CalculateCStringLength(generator_path) + CalculateCStringLength(directory) +
+        CalculateCStringLength(file_list) + (jobs ? CalculateCStringLength(jobs) : 0) + 256;
+    char *command = malloc(command_size);
+    snprintf(command, command_size, "cd \"%s\" && \"%s\" --html --html_header header.html --html_footer footer.html%s%s%s > %s",
+             directory, generator_path, jobs ? " --jobs " : "", jobs ? jobs : "", file_list, NULL_DEVICE);
+
+    double *seconds = malloc(sizeof(double)*runs);
+    for(int run = -1; run < runs; ++run)
+    {
+        u64 start_time = GetTimeMicroseconds();
+        int result = system(command);
+        u64 end_time = GetTimeMicroseconds();
+        if(result != 0)
+        {
+            fprintf(stderr, "ERROR: The generator exited with %i.\n", result);
+            return 1;
+        }
+
+        // NOTE(rjf): Run -1 warms up the file cache, and isn't counted.
+        if(run >= 0)
+        {
+            seconds[run] = (end_time - start_time) / 1000000.0;
+            Log("run %-3i %10.2f ms  %10.2f MB/s  %10.0f pages/s", run, seconds[run]*1000.0,
+                byte_count / (1024.0*1024.0) / seconds[run], page_count / seconds[run]);
+        }
+    }
+
+    double mean = 0;
+    double min = seconds[0];
+    double max = seconds[0];
+    for(int run = 0; run < runs; ++run)
+    {
+        mean += seconds[run] / runs;
+        min = seconds[run] < min ? seconds[run] : min;
+        max = seconds[run] > max ? seconds[run] : max;
+    }
+    double variance = 0;
+    for(int run = 0; run < runs; ++run)
+    {
+        variance += (seconds[run] - mean)*(seconds[run] - mean);
+    }
+    variance = runs > 1 ? variance / (runs-1) : 0;
+    double deviation = sqrt(variance);
+
+    Log("mean     %10.2f ms  %10.2f MB/s  %10.0f pages/s", mean*1000.0,
+        byte_count / (1024.0*1024.0) / mean, page_count / mean);
+    Log("min/max  %10.2f / %.2f ms, standard deviation %.2f ms (%.1f%%)", min*1000.0, max*1000.0,
+        deviation*1000.0, 100.0*deviation / mean);
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+// NOTE(rjf): Tokenizer/parser micro-benchmark.
+//
+// Lexes and parses the given .rxw files a number of times, and reports throughput in
+// tokens per second. "Tokens" is always the number of tokens in the input as counted by a
+// plain lexing pass, so numbers from different versions of the parser are comparable.
+//
+// Usage: tokenizer_benchmark [--iterations <n>] [--synthetic <megabytes>] [<file> ...]
+//
+// --synthetic adds a generated corpus of the given size: long prose paragraphs with some
+// inline styling, links, and the occasional code block, in the style of the blog posts.
+
+// NOTE(rjf): This pulls in the whole generator, most of which only its main() calls.
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#define GENERATOR_NO_MAIN
+#include "generator.c"
+
+static u32
+NextRandom(u32 *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static char *
+GenerateSyntheticCorpus(int megabytes)
+{
+    static char *words[] =
+    {
+        "the", "entity", "memory", "system", "data", "is", "a", "of", "to", "and", "code",
+        "generation", "parser", "which", "allows", "for", "very", "simple", "engine", "that",
+        "structure", "in", "game", "design", "with", "each", "frame", "it", "we", "can",
+    };
+    int word_count = sizeof(words)/sizeof(words[0]);
+    
+    u64 target_size = (u64)megabytes*1024*1024;
+    OutputBuffer buffer = {0};
+    u32 random = 1234;
+    
+    OutputBufferAppendString(&buffer, "@Title {\"Synthetic Corpus\"}\n@Date {2019/11/6}\n\n");
+    while(buffer.size < target_size)
+    {
+        u32 roll = NextRandom(&random) % 16;
+        if(roll == 0)
+        {
+            OutputBufferAppendString(&buffer, "@Code {\nstatic int\nFoo(int x)\n{\n    return x*2; // double\n}\n}\n\n");
+        }
+        else if(roll == 1)
+        {
+            OutputBufferAppendString(&buffer, "@SubTitle {\"A Section\"}\n\n");
+        }
+        else
+        {
+            int sentence_count = 3 + NextRandom(&random) % 6;
+            for(int sentence = 0; sentence < sentence_count; ++sentence)
+            {
+                int length = 6 + NextRandom(&random) % 14;
+                for(int i = 0; i < length; ++i)
+                {
+                    u32 style = NextRandom(&random) % 64;
+                    char *word = words[NextRandom(&random) % word_count];
+                    if(style == 0)
+                    {
+                        OutputBufferAppendString(&buffer, "*");
+                        OutputBufferAppendString(&buffer, word);
+                        OutputBufferAppendString(&buffer, "* ");
+                    }
+                    else if(style == 1)
+                    {
+                        OutputBufferAppendString(&buffer, "`");
+                        OutputBufferAppendString(&buffer, word);
+                        OutputBufferAppendString(&buffer, "` ");
+                    }
+                    else if(style == 2)
+                    {
+                        OutputBufferAppendString(&buffer, "@Link {\"");
+                        OutputBufferAppendString(&buffer, word);
+                        OutputBufferAppendString(&buffer, "\", \"https://ryanfleury.net\"} ");
+                    }
+                    else
+                    {
+                        OutputBufferAppendString(&buffer, word);
+                        OutputBufferAppendString(&buffer, i+1 < length ? " " : ". ");
+                    }
+                }
+            }
+            OutputBufferAppendString(&buffer, "\n\n");
+        }
+    }
+    OutputBufferAppendChar(&buffer, 0);
+    
+    return buffer.data;
+}
+
+static void
+ReportThroughput(char *name, u64 token_count, u64 byte_count, int iterations, u64 microseconds)
+{
+    double seconds = microseconds / 1000000.0;
+    if(seconds <= 0)
+    {
+        seconds = 0.000001;
+    }
+    Log("%-8s %10.2f ms  %14.0f tokens/s  %10.2f MB/s", name, microseconds / 1000.0,
+        (double)token_count * iterations / seconds,
+        (double)byte_count * iterations / seconds / (1024.0*1024.0));
+}
+
+int
+main(int argument_count, char **arguments)
+{
+    int iterations = 100;
+    int synthetic_megabytes = 0;
+    int file_count = 0;
+    char **filenames = malloc(sizeof(char *)*argument_count);
+
+    for(int i = 1; i < argument_count; ++i)
+    {
+        if(CStringMatchCaseInsensitive(arguments[i], "--iterations") && i+1 < argument_count)
+        {
+            iterations = CStringToInt(arguments[i+1]);
+            ++i;
+        }
+        else if(CStringMatchCaseInsensitive(arguments[i], "--synthetic") && i+1 < argument_count)
+        {
+            synthetic_megabytes = CStringToInt(arguments[i+1]);
+            ++i;
+        }
+        else
+        {
+            filenames[file_count++] = arguments[i];
+        }
+    }
+
+    if((file_count == 0 && synthetic_megabytes <= 0) || iterations <= 0)
+    {
+        fprintf(stderr, "USAGE: %s [--iterations <n>] [--synthetic <megabytes>] [<file> ...]\n", arguments[0]);
+        return 1;
+    }
+
+    char **files = malloc(sizeof(char *)*(file_count+1));
+    for(int i = 0; i < file_count; ++i)
+    {
+        files[i] = LoadEntireFileAndNullTerminate(filenames[i]);
+        if(!files[i])
+        {
+            fprintf(stderr, "ERROR: Could not load \"%s\".\n", filenames[i]);
+            return 1;
+        }
+    }
+    if(synthetic_megabytes > 0)
+    {
+        filenames[file_count] = "<synthetic>";
+        files[file_count] = GenerateSyntheticCorpus(synthetic_megabytes);
+        ++file_count;
+    }
+
+    u64 byte_count = 0;
+    u64 token_count = 0;
+    for(int i = 0; i < file_count; ++i)
+    {
+        byte_count += CalculateCStringLength(files[i]);
+        token_count += CountTokens(files[i], filenames[i]);
+    }
+
+    Log("%i file(s), %llu bytes, %llu tokens, %i iterations.", file_count,
+        (unsigned long long)byte_count, (unsigned long long)token_count, iterations);
+
+    // NOTE(rjf): Lexing alone.
+    {
+        u64 start_time = GetTimeMicroseconds();
+        u64 check = 0;
+        for(int iteration = 0; iteration < iterations; ++iteration)
+        {
+            for(int i = 0; i < file_count; ++i)
+            {
+                check += CountTokens(files[i], filenames[i]);
+            }
+        }
+        u64 end_time = GetTimeMicroseconds();
+        if(check != token_count * iterations)
+        {
+            fprintf(stderr, "ERROR: Token count changed between iterations.\n");
+        }
+        ReportThroughput("lex", token_count, byte_count, iterations, end_time - start_time);
+    }
+
+    // NOTE(rjf): Full parse, which is what the generator actually does. Like a build, each
+    // iteration keeps every page it parses, and then releases them all at once.
+    {
+        ParseContext context = {0};
+        u64 start_time = GetTimeMicroseconds();
+        for(int iteration = 0; iteration < iterations; ++iteration)
+        {
+            for(int i = 0; i < file_count; ++i)
+            {
+                ResetParseErrors(&context);
+                Tokenizer tokenizer = {0};
+                tokenizer.at = files[i];
+                tokenizer.line = 1;
+                tokenizer.file = filenames[i];
+                ParseText(&context, &tokenizer);
+            }
+            ArenaRelease(&context.arena);
+        }
+        u64 end_time = GetTimeMicroseconds();
+        ReportThroughput("parse", token_count, byte_count, iterations, end_time - start_time);
+    }
+
+    return 0;
+}
@@ -4,8 +4,6 @@ rem --- Make Directories
 if not exist generated mkdir generated
 
 rem --- Generate HTML
-start /b "" "xcopy" .\data .\generated\data\ /y /s /e /q
-start /b /wait "" "xcopy" search.js generated\ /y
 set files=
 for %%i in (*.rxw) do ( call set "files=%%files%% %%i" )
-..\..\generator\build\generator.exe --main_title "Data Desk" --author "Ryan Fleury" --canonical_url "https://data-desk.net" --twitter_handle "@ryanjfleury" --html --html_header header.html --html_footer footer.html %files% custom_layer_api.html
\ No newline at end of file
+..\..\generator\build\generator.exe --main_title "Data Desk" --author "Ryan Fleury" --canonical_url "https://data-desk.net" --twitter_handle "@ryanjfleury" --incremental --html --html_header header.html --html_footer footer.html --copy_assets data generated\data --copy_assets search.js generated\search.js %files% custom_layer_api.html
\ No newline at end of file
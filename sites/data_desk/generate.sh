@@ -0,0 +1,9 @@
+#!/bin/sh
+set -e
+cd "$(dirname "$0")"
+
+# --- Make Directories
+mkdir -p generated
+
+# --- Generate HTML
+../../generator/build/generator --main_title "Data Desk" --author "Ryan Fleury" --canonical_url "https://data-desk.net" --twitter_handle "@ryanjfleury" --incremental --html --html_header header.html --html_footer footer.html --copy_assets data generated/data --copy_assets search.js generated/search.js *.rxw custom_layer_api.html
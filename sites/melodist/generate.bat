@@ -1,6 +1,5 @@
 @echo off
 if not exist generated mkdir generated
-start /b /wait "" "xcopy" .\data .\generated\data\ /y /s /e /q
 set files= 
 for %%i in (*.rxw) do ( call set "files=%%files%% %%i" )
-..\..\generator\build\generator.exe --author "Ryan Fleury" --canonical_url "https://the-melodist.net" --twitter_handle "@TheMelodistGame" --html --html_header header.html --html_footer footer.html %files%
\ No newline at end of file
+..\..\generator\build\generator.exe --author "Ryan Fleury" --canonical_url "https://the-melodist.net" --twitter_handle "@TheMelodistGame" --incremental --html --html_header header.html --html_footer footer.html --copy_assets data generated\data %files%
\ No newline at end of file
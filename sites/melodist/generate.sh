@@ -0,0 +1,5 @@
+#!/bin/sh
+set -e
+cd "$(dirname "$0")"
+mkdir -p generated
+../../generator/build/generator --author "Ryan Fleury" --canonical_url "https://the-melodist.net" --twitter_handle "@TheMelodistGame" --incremental --html --html_header header.html --html_footer footer.html --copy_assets data generated/data *.rxw
@@ -5,10 +5,9 @@ if not exist generated mkdir generated
 if not exist unmapped_drawings\generated mkdir unmapped_drawings\generated
 
 rem --- Generate HTML
-start /b /wait "" "xcopy" .\data .\generated\data\ /y /s /e /q
 set files= 
 for %%i in (*.rxw) do ( call set "files=%%files%% %%i" )
-..\..\generator\build\generator.exe --main_title "Ryan Fleury" --author "Ryan Fleury" --canonical_url "https://ryanfleury.net" --twitter_handle "@ryanjfleury" --html --html_header header.html --html_footer footer.html %files%
+..\..\generator\build\generator.exe --main_title "Ryan Fleury" --author "Ryan Fleury" --canonical_url "https://ryanfleury.net" --twitter_handle "@ryanjfleury" --incremental --html --html_header header.html --html_footer footer.html --critical_css data\styles.css --copy_assets data generated\data %files%
 
 rem --- Generate color-mapped textures
 pushd unmapped_drawings
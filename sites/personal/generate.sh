@@ -0,0 +1,14 @@
+#!/bin/sh
+set -e
+cd "$(dirname "$0")"
+
+# --- Make Directories
+mkdir -p generated
+mkdir -p unmapped_drawings/generated
+
+# --- Generate HTML
+../../generator/build/generator --main_title "Ryan Fleury" --author "Ryan Fleury" --canonical_url "https://ryanfleury.net" --twitter_handle "@ryanjfleury" --incremental --html --html_header header.html --html_footer footer.html --critical_css data/styles.css --copy_assets data generated/data *.rxw
+
+# --- Generate color-mapped textures
+cd unmapped_drawings
+../../../color_mapper/build/color_mapper --primary 1 1 1 --secondary 0.8 0.8 0.8 --highlight 1.0 0.6823529 0.2588235 *.png